@@ -0,0 +1,98 @@
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "game.h"
+#include "game_io.h"
+#include "negamax.h"
+
+// Searches every position of a suite to a fixed depth with a fresh Negamax
+// and prints one line of "key value" pairs per position and a total line,
+// so runs can be diffed. The signature is a hash of the node counts: it
+// changes exactly when the search visits different nodes, so a pure speed-up
+// keeps it.
+//
+// Suite records are a line "bench <name> <depth>" followed by a game state
+// and a blank line; lines starting with # are comments.
+//
+// Usage: ./bench [suite] [depth]
+//   depth overrides the depth of every position
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+int main(int argc, char *argv[]) {
+  const char *filename = argc > 1 ? argv[1] : "positions/bench.txt";
+  int depth_override = argc > 2 ? std::atoi(argv[2]) : 0;
+  std::ifstream in(filename);
+  if (!in) {
+    std::cerr << "could not open " << filename << std::endl;
+    return 1;
+  }
+
+  int positions = 0;
+  long long total_nodes = 0;
+  long long total_probes = 0;
+  long long total_hits = 0;
+  double total_seconds = 0;
+  unsigned long long signature = 14695981039346656037ULL; // FNV-1a
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream ls(line);
+    std::string word, name;
+    int depth;
+    if (!(ls >> word >> name >> depth) || word != "bench") {
+      continue;
+    }
+    std::map<int, std::string> system_names;
+    Game *game = read_game(in, system_names);
+    if (game == nullptr) {
+      std::cerr << "skipping malformed position " << name << std::endl;
+      continue;
+    }
+    if (depth_override > 0) {
+      depth = depth_override;
+    }
+
+    Negamax negamax(game);
+    std::ostringstream time_to_depth;
+    auto start = std::chrono::steady_clock::now();
+    for (int d = 1; d <= depth; d++) {
+      negamax.get_actions(d);
+      time_to_depth << (d > 1 ? "," : "") << d << ":"
+        << (long long)(seconds_since(start) * 1000);
+    }
+    double seconds = seconds_since(start);
+    const SearchStats& stats = negamax.stats();
+
+    positions++;
+    total_nodes += stats.nodes;
+    total_probes += stats.tt_probes;
+    total_hits += stats.tt_hits;
+    total_seconds += seconds;
+    for (int i = 0; i < 8; i++) {
+      signature = (signature ^ ((stats.nodes >> (8 * i)) & 0xff)) *
+        1099511628211ULL;
+    }
+
+    std::cout << "position " << positions << " name " << name
+      << " depth " << depth << " nodes " << stats.nodes
+      << " evals " << stats.evals << " tt_probes " << stats.tt_probes
+      << " tt_hits " << stats.tt_hits << " tt_cutoffs " << stats.tt_cutoffs
+      << " ms " << (long long)(seconds * 1000)
+      << " nps " << (long long)(stats.nodes / seconds)
+      << " time_to_depth " << time_to_depth.str() << std::endl;
+    delete game;
+  }
+
+  std::cout << "total positions " << positions << " nodes " << total_nodes
+    << " ms " << (long long)(total_seconds * 1000)
+    << " nps " << (long long)(total_nodes / total_seconds)
+    << " tt_hit_rate " << (total_probes > 0 ? (double)total_hits / total_probes : 0)
+    << " signature " << std::hex << signature << std::dec << std::endl;
+}
@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#include "evaluator.h"
+#include "game.h"
+#include "game_io.h"
+#include "negamax.h"
+#include "opening_book.h"
+#include "playout.h"
+
+// Builds and prints opening books of homeworld setups (see opening_book.h).
+//
+// Every setup of the first player is scored over a number of self-play
+// games against random replies, and every reply to the best first setups
+// is scored the same way. Games open with a few random turns for variety,
+// continue with fixed-depth negamax on both sides and are draws after the
+// turn limit.
+//
+// Usage: ./book build <book> [-g games] [-k first setups to answer]
+//                     [-d depth] [-m max turns] [-r random turns]
+//                     [-t threads]
+//        ./book show <book>
+
+struct Options {
+  int games = 2;
+  int replies = 4;
+  int depth = 1;
+  int max_turns = 40;
+  int random_turns = 2;
+  int threads = 1;
+};
+
+struct Job {
+  const Game *position; // before the setup
+  Action setup;
+  size_t entry; // index into the entries
+};
+
+// Plays one game after setup in position and returns the half points won
+// by the player who made it
+static int play_game(const Game& position, Action setup, Rng& rng,
+                     const Evaluator& evaluator, const Options& options) {
+  Game game(position);
+  int player = game.cur_player();
+  Action pass = Action{player, PASS};
+  game.perform_action(setup);
+  game.perform_action(pass);
+  while (game.homeworlds_built() < game.num_players()) {
+    random_turn(game, rng);
+  }
+
+  Negamax *searches[3] = {nullptr, new Negamax(&game, evaluator),
+    new Negamax(&game, evaluator)};
+  for (int turn = 0; turn < options.max_turns && game.winner() == 0; turn++) {
+    if (turn < options.random_turns) {
+      random_turn(game, rng);
+      continue;
+    }
+    Negamax& search = *searches[game.cur_player()];
+    search.set_root(&game);
+    std::vector<Action> actions;
+    for (int depth = 1; depth <= options.depth; depth++) {
+      actions = search.get_actions(depth);
+    }
+    for (Action action : actions) {
+      game.perform_action(action);
+    }
+  }
+  delete searches[1];
+  delete searches[2];
+
+  int winner = game.winner();
+  return winner == player ? 2 : winner <= 0 ? 1 : 0;
+}
+
+// Scores the setups of every job on a thread pool
+static void run_jobs(const std::vector<Job>& jobs,
+                     std::vector<BookEntry>& entries, const Options& options) {
+  Evaluator evaluator;
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < options.threads; i++) {
+    threads.push_back(std::thread([&]() {
+          for (size_t j = next++; j < jobs.size(); j = next++) {
+            Rng rng(j + 1);
+            BookEntry& entry = entries[jobs[j].entry];
+            for (int g = 0; g < options.games; g++) {
+              entry.points += play_game(*jobs[j].position, jobs[j].setup, rng,
+                  evaluator, options);
+              entry.games++;
+            }
+          }
+        }));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+// Adds an entry and a job for every setup in position
+static void add_setups(const Game& position, std::vector<BookEntry>& entries,
+                       std::vector<Job>& jobs) {
+  std::vector<Action> setups;
+  position.legal_actions(setups);
+  PositionKey key = encode_position(position);
+  for (const Action& setup : setups) {
+    jobs.push_back(Job{&position, setup, entries.size()});
+    entries.push_back(BookEntry{key, setup, 0, 0});
+  }
+}
+
+static int build(const std::string& filename, const Options& options) {
+  std::ofstream out(filename, std::ios::binary);
+  if (!out) {
+    std::cerr << "could not open " << filename << std::endl;
+    return 1;
+  }
+
+  Game root(2);
+  std::vector<BookEntry> entries;
+  std::vector<Job> jobs;
+  add_setups(root, entries, jobs);
+  run_jobs(jobs, entries, options);
+  std::cerr << "first setups " << entries.size() << std::endl;
+
+  std::vector<BookEntry> firsts(entries);
+  std::sort(firsts.begin(), firsts.end(),
+      [](const BookEntry& a, const BookEntry& b) {
+        return a.score() > b.score();
+      });
+  firsts.resize(std::min((int)firsts.size(), options.replies));
+  std::vector<Game*> positions;
+  jobs.clear();
+  for (const BookEntry& first : firsts) {
+    Game *position = new Game(root);
+    Action setup = first.setup;
+    Action pass = Action{1, PASS};
+    setup.player = 1;
+    position->perform_action(setup);
+    position->perform_action(pass);
+    positions.push_back(position);
+    add_setups(*position, entries, jobs);
+  }
+  run_jobs(jobs, entries, options);
+  std::cerr << "replies " << jobs.size() << std::endl;
+
+  write_book(out, entries);
+  for (Game *position : positions) {
+    delete position;
+  }
+  return 0;
+}
+
+static int show(const std::string& filename) {
+  OpeningBook book;
+  if (!book.open(filename)) {
+    std::cerr << "could not read opening book from " << filename << std::endl;
+    return 1;
+  }
+  for (size_t i = 0; i < book.size(); i++) {
+    BookEntry entry = book.entry(i);
+    Game *position = decode_position(entry.key);
+    std::cout << "homeworlds " << position->homeworlds_built() << " " <<
+      entry.setup << " games " << entry.games << " score " << entry.score();
+    for (const System& system : position->systems()) {
+      std::cout << " | " << system;
+    }
+    std::cout << std::endl;
+    delete position;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  std::string command = argc > 2 ? argv[1] : "";
+  if (command == "show") {
+    return show(argv[2]);
+  } else if (command == "build") {
+    Options options;
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 3; i + 1 < argc; i += 2) {
+      std::string arg = argv[i];
+      int value = std::max(0, std::atoi(argv[i + 1]));
+      if (arg == "-g") {
+        options.games = std::max(1, value);
+      } else if (arg == "-k") {
+        options.replies = value;
+      } else if (arg == "-d") {
+        options.depth = std::max(1, value);
+      } else if (arg == "-m") {
+        options.max_turns = value;
+      } else if (arg == "-r") {
+        options.random_turns = value;
+      } else if (arg == "-t") {
+        options.threads = std::max(1, value);
+      }
+    }
+    return build(argv[2], options);
+  }
+
+  std::cerr << "usage: ./book build <book> [-g games] "
+    "[-k first setups to answer] [-d depth] [-m max turns] "
+    "[-r random turns] [-t threads]" << std::endl;
+  std::cerr << "       ./book show <book>" << std::endl;
+  return 1;
+}
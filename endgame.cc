@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <unistd.h>
+
+#include "game.h"
+#include "game_io.h"
+#include "position_key.h"
+#include "tablebase.h"
+
+// Builds and probes endgame tablebases (see tablebase.h).
+//
+// The table covers every two player position with the homeworlds of the
+// given games, or what catastrophes can leave of them, and at most a number
+// of ships in play, counting both players. Generation runs in three steps:
+//
+//   1. enumerate the positions and sort their keys
+//   2. generate every position's turns and look up the resulting positions,
+//      on a thread pool. Finished chunks of positions are appended to
+//      <table>.partial, so an interrupted build resumes where it stopped.
+//   3. retrograde analysis: positions where the player to move can win at
+//      once are wins in 1, and from there in increasing distance, a
+//      position with a turn to a lost position is won and a position all
+//      of whose turns lead to won positions is lost.
+//
+// A turn that leaves the table (a tie, or a position with too many ships)
+// may escape, so a position with such a turn is never proven lost.
+// Positions that are neither won nor lost are left out of the table.
+//
+// Usage: ./endgame build <table> <games> [-s ships in play] [-t threads]
+//        ./endgame probe <table> < game
+
+const static int CHUNK = 256;
+const static unsigned int PARTIAL_VERSION = 1;
+
+struct Build {
+  const std::vector<PositionKey> *keys;
+  int max_ships; // in play
+  std::vector<TablebaseNode> nodes;
+  std::vector<size_t> chunks; // still to generate
+  std::atomic<size_t> next;
+  std::mutex lock; // guards partial
+  std::ofstream partial;
+};
+
+static void write_u32(std::ostream& os, unsigned int value) {
+  for (int i = 0; i < 4; i++) {
+    os.put((char)(value >> (8 * i)));
+  }
+}
+
+static void write_u64(std::ostream& os, unsigned long long value) {
+  write_u32(os, value);
+  write_u32(os, value >> 32);
+}
+
+static bool read_u32(std::istream& is, unsigned int& value) {
+  unsigned char bytes[4];
+  if (!is.read((char*)bytes, 4)) {
+    return false;
+  }
+  value = bytes[0] | bytes[1] << 8 | bytes[2] << 16 |
+    (unsigned int)bytes[3] << 24;
+  return true;
+}
+
+static bool read_u64(std::istream& is, unsigned long long& value) {
+  unsigned int low, high;
+  if (!read_u32(is, low) || !read_u32(is, high)) {
+    return false;
+  }
+  value = (unsigned long long)high << 32 | low;
+  return true;
+}
+
+static unsigned long long checksum(const std::vector<PositionKey>& keys) {
+  unsigned long long sum = keys.size();
+  for (const PositionKey& key : keys) {
+    sum = sum * 1000003 + hash(key);
+  }
+  return sum;
+}
+
+static void write_chunk(Build& build, size_t chunk) {
+  std::ostringstream payload;
+  size_t end = std::min(build.nodes.size(), (size_t)(chunk + 1) * CHUNK);
+  for (size_t i = chunk * CHUNK; i < end; i++) {
+    const TablebaseNode& node = build.nodes[i];
+    payload.put((char)(node.win_now | node.escape << 1));
+    write_u32(payload, node.successors.size());
+    for (unsigned int successor : node.successors) {
+      write_u32(payload, successor);
+    }
+  }
+  std::lock_guard<std::mutex> lock(build.lock);
+  write_u32(build.partial, chunk);
+  write_u32(build.partial, payload.str().size());
+  build.partial << payload.str();
+  build.partial.flush();
+}
+
+// Reads the chunks finished by an earlier run, and returns the length of
+// the file up to the last whole chunk, or 0 if it belongs to another table
+static size_t read_partial(const std::string& filename, Build& build,
+                           std::vector<bool>& done) {
+  std::ifstream in(filename, std::ios::binary);
+  char magic[4];
+  unsigned int version, max_ships;
+  unsigned long long positions, sum;
+  if (!in.read(magic, 4) || std::memcmp(magic, "HWTP", 4) != 0 ||
+      !read_u32(in, version) || version != PARTIAL_VERSION ||
+      !read_u32(in, max_ships) || (int)max_ships != build.max_ships ||
+      !read_u64(in, positions) || positions != build.keys->size() ||
+      !read_u64(in, sum) || sum != checksum(*build.keys)) {
+    return 0;
+  }
+
+  size_t length = in.tellg();
+  unsigned int chunk, bytes;
+  while (read_u32(in, chunk) && read_u32(in, bytes)) {
+    std::string payload(bytes, '\0');
+    if ((size_t)chunk * CHUNK >= build.nodes.size() ||
+        !in.read(&payload[0], bytes)) {
+      break;
+    }
+    std::istringstream is(payload);
+    size_t end = std::min(build.nodes.size(), (size_t)(chunk + 1) * CHUNK);
+    bool whole = true;
+    for (size_t i = (size_t)chunk * CHUNK; i < end && whole; i++) {
+      TablebaseNode& node = build.nodes[i];
+      int flags = is.get();
+      unsigned int count, successor;
+      whole = read_u32(is, count);
+      node = TablebaseNode{(flags & 1) != 0, (flags & 2) != 0};
+      for (unsigned int s = 0; s < count && whole; s++) {
+        whole = read_u32(is, successor);
+        node.successors.push_back(successor);
+      }
+    }
+    if (!whole) {
+      break;
+    }
+    done[chunk] = true;
+    length = in.tellg();
+  }
+  return length;
+}
+
+static void open_partial(const std::string& filename, Build& build) {
+  size_t chunks = (build.nodes.size() + CHUNK - 1) / CHUNK;
+  std::vector<bool> done(chunks, false);
+  size_t length = read_partial(filename, build, done);
+  if (length > 0 && truncate(filename.c_str(), length) == 0) {
+    build.partial.open(filename, std::ios::binary | std::ios::app);
+  } else {
+    build.nodes.assign(build.nodes.size(), TablebaseNode());
+    done.assign(chunks, false);
+    build.partial.open(filename, std::ios::binary | std::ios::trunc);
+    build.partial.write("HWTP", 4);
+    write_u32(build.partial, PARTIAL_VERSION);
+    write_u32(build.partial, build.max_ships);
+    write_u64(build.partial, build.keys->size());
+    write_u64(build.partial, checksum(*build.keys));
+    build.partial.flush();
+  }
+  for (size_t chunk = 0; chunk < chunks; chunk++) {
+    if (!done[chunk]) {
+      build.chunks.push_back(chunk);
+    }
+  }
+  std::cerr << "chunks " << chunks << " resumed " << chunks -
+    build.chunks.size() << std::endl;
+}
+
+static int build(const std::string& filename, const std::string& games_file,
+                 int max_ships, int num_threads) {
+  auto start = std::chrono::steady_clock::now();
+  std::ifstream in(games_file);
+  if (!in) {
+    std::cerr << "could not open " << games_file << std::endl;
+    return 1;
+  }
+  std::vector<Game*> games;
+  while (in >> std::ws && !in.eof()) {
+    std::map<int, std::string> system_names;
+    Game *game = read_game(in, system_names);
+    if (game == nullptr) {
+      std::cerr << "skipping a malformed game" << std::endl;
+      continue;
+    }
+    if (game->num_players() != 2 || game->homeworlds_built() < 2) {
+      std::cerr << "skipping a game without two homeworlds" << std::endl;
+      delete game;
+      continue;
+    }
+    games.push_back(game);
+  }
+  if (games.empty()) {
+    std::cerr << "no games in " << games_file << std::endl;
+    return 1;
+  }
+
+  std::vector<PositionKey> keys = enumerate_endgame(games, max_ships);
+  for (Game *game : games) {
+    delete game;
+  }
+  std::cerr << "positions " << keys.size() << std::endl;
+
+  Build build;
+  build.keys = &keys;
+  build.max_ships = max_ships;
+  build.nodes.resize(keys.size());
+  build.next = 0;
+  std::string partial = filename + ".partial";
+  open_partial(partial, build);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.push_back(std::thread([&build]() {
+          for (size_t c = build.next++; c < build.chunks.size();
+               c = build.next++) {
+            size_t chunk = build.chunks[c];
+            size_t end = std::min(build.nodes.size(),
+                (size_t)(chunk + 1) * CHUNK);
+            for (size_t i = chunk * CHUNK; i < end; i++) {
+              build.nodes[i] = generate_node(*build.keys, i,
+                  build.max_ships);
+            }
+            write_chunk(build, chunk);
+          }
+        }));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  build.partial.close();
+
+  std::vector<int> turns = retrograde(build.nodes);
+  std::vector<TablebaseEntry> entries;
+  int wins = 0;
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (turns[i] != 0) {
+      entries.push_back(TablebaseEntry{keys[i], turns[i]});
+      wins += turns[i] > 0;
+    }
+  }
+  std::ofstream out(filename, std::ios::binary);
+  if (!out) {
+    std::cerr << "could not open " << filename << std::endl;
+    return 1;
+  }
+  write_tablebase(out, max_ships, entries);
+  out.close();
+  std::remove(partial.c_str());
+
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  std::cerr << "wins " << wins << " losses " << entries.size() - wins <<
+    " unknown " << keys.size() - entries.size() << " seconds " <<
+    elapsed.count() << std::endl;
+  return 0;
+}
+
+static int probe(const std::string& filename) {
+  Tablebase tablebase;
+  if (!tablebase.open(filename)) {
+    std::cerr << "could not read tablebase from " << filename << std::endl;
+    return 1;
+  }
+  std::map<int, std::string> system_names;
+  Game *game = read_game(std::cin, system_names);
+  if (game == nullptr) {
+    std::cerr << "malformed game" << std::endl;
+    return 1;
+  }
+  int turns;
+  if (game->num_players() != 2 || game->winner() != 0) {
+    std::cout << "not covered" << std::endl;
+  } else if (!tablebase.probe(*game, turns)) {
+    std::cout << "unknown" << std::endl;
+  } else {
+    std::cout << (turns > 0 ? "win" : "loss") << " in " << std::abs(turns) <<
+      " turns" << std::endl;
+  }
+  delete game;
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  std::string command = argc > 2 ? argv[1] : "";
+  if (command == "probe") {
+    return probe(argv[2]);
+  } else if (command == "build" && argc > 3) {
+    int max_ships = 3;
+    int num_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 4; i + 1 < argc; i += 2) {
+      std::string arg = argv[i];
+      int value = std::max(1, std::atoi(argv[i + 1]));
+      if (arg == "-s") {
+        max_ships = value;
+      } else if (arg == "-t") {
+        num_threads = value;
+      }
+    }
+    return build(argv[2], argv[3], max_ships, num_threads);
+  }
+
+  std::cerr << "usage: ./endgame build <table> <games> "
+    "[-s ships in play] [-t threads]" << std::endl;
+  std::cerr << "       ./endgame probe <table> < game" << std::endl;
+  return 1;
+}
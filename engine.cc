@@ -0,0 +1,366 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "evaluator.h"
+#include "game.h"
+#include "game_io.h"
+#include "multi_search.h"
+#include "negamax.h"
+#include "nnue.h"
+#include "opening_book.h"
+#include "position_history.h"
+#include "proof_search.h"
+#include "tablebase.h"
+#include "trace.h"
+
+// Long-lived engine speaking a line based protocol on stdin and stdout, so a
+// front end can keep one process, and its transposition table, for a whole
+// game.
+//
+//   position           followed by a game state and a blank line
+//   go [depth D] [movetime MS] [infinite]
+//   stop               ends the running search early
+//   setoption name <Depth|Weights|Network|Book|Tablebase|ProofNodes|Ponder>
+//             value <value>
+//   newgame            forgets transpositions and positions from earlier
+//                      games
+//   isready            answered with readyok
+//   quit
+//
+// A search prints "info depth D score S nodes N time MS" after every
+// completed iteration, "info stats" with the search statistics as JSON, then
+// "bestmove", the actions one per line and a blank line. Without a depth or
+// time limit, go searches to the Depth option. Games with more than two
+// players are searched to at most Depth plies whatever the time limit.
+// Homeworld setups found in the Book are played without searching, after an
+// "info book" line. Positions the endgame Tablebase has a result for are
+// scored exactly. Positions given since newgame are remembered, and search
+// scores returning to any of them as a draw.
+//
+// With ProofNodes above 0, every iteration of a two player search is
+// preceded by a slice of proof-number search (see proof_search.h) for a win
+// within 2 * depth + 1 turns, expanding at most ProofNodes positions. Its
+// table is kept between slices, so each continues the last. A proven win is
+// played at once, after an "info proof turns T positions N" line.
+//
+// With Ponder set to true, a two player search goes on after its bestmove
+// with the position after that turn, printing "info ponder depth D score S
+// nodes N" per iteration. Searching the opponent's position to depth D
+// fills the shared transposition table for every reply to depth D - 1, so
+// the next search starts from that work whichever reply is played. The
+// next command other than isready stops pondering; the table is kept.
+
+const static int MAX_DEPTH = 64;
+
+struct Engine {
+  NnueNetwork *network = nullptr;
+  OpeningBook *book = nullptr;
+  Tablebase *tablebase = nullptr;
+  int depth = 2;
+  int proof_nodes = 0;
+  bool ponder = false;
+  ProofSearch proof;
+  Game *game = nullptr;
+  PositionHistory history; // earlier positions, not including game
+  std::map<int, std::string> system_names;
+  Negamax negamax{nullptr};
+  std::thread searcher;
+  std::mutex output;
+  std::mutex ponder_lock; // guards pondering and ponder_cancelled
+  bool pondering = false;
+  bool ponder_cancelled = false; // by a command since the last go
+
+  ~Engine() {
+    delete game;
+    delete network;
+    delete book;
+    delete tablebase;
+  }
+
+  void wait() {
+    if (searcher.joinable()) {
+      searcher.join();
+    }
+  }
+
+  void print(const std::string& text) {
+    std::lock_guard<std::mutex> lock(output);
+    std::cout << text << std::flush;
+  }
+
+  // Stops pondering, or keeps the running search from starting to
+  void cancel_ponder() {
+    std::lock_guard<std::mutex> lock(ponder_lock);
+    ponder_cancelled = true;
+    if (pondering) {
+      negamax.stop();
+    }
+  }
+};
+
+// Searches game, the position after the engine's turn, until stopped
+static void ponder(Engine *engine, const Game& game) {
+  Negamax& negamax = engine->negamax;
+  PositionHistory history(engine->history);
+  history.push(engine->game->key());
+  negamax.set_root(&game);
+  negamax.set_history(history);
+  negamax.reset_stats();
+  for (int depth = 1; depth <= MAX_DEPTH; depth++) {
+    negamax.get_actions(depth);
+    if (negamax.stopped()) {
+      break;
+    }
+    std::ostringstream info;
+    info << "info ponder depth " << depth << " score " << negamax.value()
+      << " nodes " << negamax.stats().nodes << std::endl;
+    engine->print(info.str());
+  }
+  negamax.set_root(engine->game);
+  negamax.set_history(engine->history);
+}
+
+static void search(Engine *engine, int max_depth) {
+  Game *game = engine->game;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<Action> best({Action{PASS}});
+  Action setup;
+
+  if (engine->book != nullptr && engine->book->lookup(*game, setup)) {
+    best = {setup, Action{game->cur_player(), PASS}};
+    engine->print("info book\n");
+  } else if (game->num_players() > 2) {
+    MultiSearch multi(game, BEST_REPLY);
+    for (int depth = 1; depth <= std::min(max_depth, engine->depth); depth++) {
+      best = multi.get_actions(depth);
+    }
+  } else {
+    Negamax& negamax = engine->negamax;
+    ProofSearch& proof = engine->proof;
+    negamax.reset_stats();
+    for (int depth = 1; depth <= max_depth; depth++) {
+      if (engine->proof_nodes > 0 &&
+          proof.solve(game, 2 * depth + 1, engine->proof_nodes) == PROVEN) {
+        best = proof.line()[0];
+        std::ostringstream info;
+        info << "info proof turns " << proof.line().size() << " positions "
+          << proof.nodes() << std::endl;
+        engine->print(info.str());
+        break;
+      }
+      std::vector<Action> actions = negamax.get_actions(depth);
+      if (negamax.stopped()) {
+        if (depth == 1) {
+          best = actions; // anything beats an illegal PASS
+        }
+        break;
+      }
+      best = actions;
+
+      long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start).count();
+      std::ostringstream info;
+      info << "info depth " << depth << " score " << negamax.value()
+        << " nodes " << negamax.stats().nodes << " time " << ms << std::endl;
+      engine->print(info.str());
+      if (game->winner() != 0) {
+        break;
+      }
+    }
+    std::ostringstream stats;
+    stats << "info stats ";
+    write_json(stats, negamax.stats());
+    stats << std::endl;
+    engine->print(stats.str());
+  }
+
+  // Name new systems on a copy, so repeated go commands search the same game
+  Game copy(*game);
+  std::map<int, std::string> system_names(engine->system_names);
+  std::ostringstream os;
+  os << "bestmove" << std::endl;
+  print_turn(os, copy, best, system_names);
+  os << std::endl;
+
+  // Decided before bestmove is printed, so every later command cancels it
+  bool pondering;
+  {
+    std::lock_guard<std::mutex> lock(engine->ponder_lock);
+    pondering = engine->ponder && !engine->ponder_cancelled &&
+      game->num_players() == 2 && copy.winner() == 0;
+    engine->pondering = pondering;
+    if (pondering) {
+      engine->negamax.resume();
+    }
+  }
+  engine->print(os.str());
+  if (pondering) {
+    ponder(engine, copy);
+  }
+}
+
+static void go(Engine& engine, std::istream& args) {
+  if (engine.game == nullptr) {
+    engine.print("bestmove\nPASS\n\n");
+    return;
+  }
+  int max_depth = engine.depth;
+  bool limited = false;
+  std::string arg;
+  engine.negamax.resume();
+  engine.proof.resume();
+  engine.pondering = false;
+  engine.ponder_cancelled = false;
+  while (args >> arg) {
+    if (arg == "depth") {
+      args >> max_depth;
+      limited = true;
+    } else if (arg == "movetime") {
+      int ms = 0;
+      args >> ms;
+      Deadline deadline = std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(ms);
+      engine.negamax.set_deadline(deadline);
+      engine.proof.set_deadline(deadline);
+      max_depth = limited ? max_depth : MAX_DEPTH;
+    } else if (arg == "infinite") {
+      max_depth = MAX_DEPTH;
+    }
+  }
+  engine.searcher = std::thread(search, &engine, max_depth);
+}
+
+static void set_option(Engine& engine, std::istream& args) {
+  std::string word, name, value;
+  while (args >> word) {
+    if (word == "name") {
+      args >> name;
+    } else if (word == "value") {
+      std::getline(args >> std::ws, value);
+    }
+  }
+
+  if (name == "Depth") {
+    engine.depth = std::max(1, std::atoi(value.c_str()));
+  } else if (name == "Weights") {
+    std::ifstream in(value);
+    Evaluator evaluator;
+    if (!in || !evaluator.load(in)) {
+      std::cerr << "could not load weights from " << value << std::endl;
+      return;
+    }
+    engine.negamax.set_evaluator(evaluator);
+    engine.negamax.clear();
+  } else if (name == "Network") {
+    std::ifstream in(value, std::ios::binary);
+    NnueNetwork *network = new NnueNetwork();
+    if (!network->load(in)) {
+      std::cerr << "could not load network from " << value << std::endl;
+      delete network;
+      return;
+    }
+    if (engine.game != nullptr && engine.game->num_players() == 2) {
+      engine.game->set_network(network);
+    }
+    delete engine.network;
+    engine.network = network;
+    engine.negamax.clear();
+  } else if (name == "Book") {
+    OpeningBook *book = new OpeningBook();
+    if (!book->open(value)) {
+      std::cerr << "could not read opening book from " << value << std::endl;
+      delete book;
+      return;
+    }
+    delete engine.book;
+    engine.book = book;
+  } else if (name == "Ponder") {
+    engine.ponder = value == "true";
+  } else if (name == "ProofNodes") {
+    engine.proof_nodes = std::max(0, std::atoi(value.c_str()));
+  } else if (name == "Tablebase") {
+    Tablebase *tablebase = new Tablebase();
+    if (!tablebase->open(value)) {
+      std::cerr << "could not read tablebase from " << value << std::endl;
+      delete tablebase;
+      return;
+    }
+    engine.negamax.set_tablebase(tablebase);
+    delete engine.tablebase;
+    engine.tablebase = tablebase;
+    engine.negamax.clear();
+  } else {
+    std::cerr << "unknown option " << name << std::endl;
+  }
+}
+
+int main() {
+  Engine engine;
+  std::string line;
+  while (std::getline(std::cin, line)) {
+    std::istringstream args(line);
+    std::string command;
+    if (!(args >> command)) {
+      continue;
+    }
+
+    if (command == "quit") {
+      engine.cancel_ponder();
+      engine.negamax.stop();
+      engine.proof.stop();
+      break;
+    } else if (command == "stop") {
+      engine.cancel_ponder();
+      engine.negamax.stop();
+      engine.proof.stop();
+      engine.wait();
+      continue;
+    } else if (command == "isready") {
+      engine.print("readyok\n");
+      continue;
+    }
+
+    engine.cancel_ponder();
+    engine.wait();
+    if (command == "position") {
+      engine.system_names.clear();
+      Game *game = read_game(std::cin, engine.system_names);
+      if (game == nullptr) {
+        std::cerr << "malformed position" << std::endl;
+        continue;
+      }
+      if (engine.game != nullptr && engine.game->key() != game->key()) {
+        engine.history.push(engine.game->key());
+      }
+      delete engine.game;
+      engine.game = game;
+      if (engine.network != nullptr && engine.game->num_players() == 2) {
+        engine.game->set_network(engine.network);
+      }
+      engine.negamax.set_root(engine.game);
+      engine.negamax.set_history(engine.history);
+    } else if (command == "go") {
+      go(engine, args);
+    } else if (command == "setoption") {
+      set_option(engine, args);
+    } else if (command == "newgame") {
+      engine.negamax.clear();
+      engine.proof.clear();
+      engine.history.clear();
+      engine.negamax.set_history(engine.history);
+    } else {
+      std::cerr << "unknown command " << command << std::endl;
+    }
+  }
+  engine.wait();
+#ifdef TRACE
+  std::ofstream trace("trace.json");
+  trace_dump(trace);
+#endif
+}
@@ -0,0 +1,24 @@
+#include "eval_cache.h"
+
+EvalCache::EvalCache(int size_bits) :
+    entries(1ULL << size_bits, EvalCacheEntry{0, 0}),
+    mask((1ULL << size_bits) - 1) {}
+
+bool EvalCache::probe(unsigned long long key, int& value) {
+  const EvalCacheEntry& entry = entries[key & mask];
+  if (entry.key != key) {
+    return false;
+  }
+  value = entry.value;
+  return true;
+}
+
+void EvalCache::store(unsigned long long key, int value) {
+  entries[key & mask] = EvalCacheEntry{key, value};
+}
+
+void EvalCache::clear() {
+  for (EvalCacheEntry& entry : entries) {
+    entry = EvalCacheEntry{0, 0};
+  }
+}
@@ -0,0 +1,26 @@
+#ifndef EVAL_CACHE_H
+#define EVAL_CACHE_H
+
+#include <vector>
+
+// Fixed-size, lossy cache of leaf evaluations keyed by Game::key(). Each key
+// maps to a single slot and a store simply replaces whatever was there.
+struct EvalCacheEntry {
+  unsigned long long key;
+  int value;
+};
+
+class EvalCache {
+  public:
+    EvalCache(int size_bits = 16);
+
+    bool probe(unsigned long long key, int& value);
+    void store(unsigned long long key, int value);
+    void clear();
+
+  private:
+    std::vector<EvalCacheEntry> entries;
+    unsigned long long mask;
+};
+
+#endif
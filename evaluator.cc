@@ -0,0 +1,120 @@
+#include <sstream>
+
+#include "evaluator.h"
+
+const static int DEFAULT_WEIGHTS[NUM_FEATURES] = {
+  100, // small_ships
+  400, // medium_ships
+  900, // large_ships
+  50, // fleet_colours
+  100, // home_colours
+  150, // home_star_sizes
+  50, // home_star_colours
+  -150, // home_overpopulation
+  30, // cheap_builds
+  -150, // attackable_ships
+  -200 // home_invaders
+};
+
+Evaluator::Evaluator() :
+    weights(DEFAULT_WEIGHTS, DEFAULT_WEIGHTS + NUM_FEATURES) {}
+
+bool Evaluator::load(std::istream& is) {
+  std::string line;
+  while (std::getline(is, line)) {
+    std::istringstream lis(line);
+    std::string name;
+    int weight;
+    if (!(lis >> name) || name[0] == '#') {
+      continue;
+    }
+    if (!(lis >> weight)) {
+      return false;
+    }
+    int feature = 0;
+    while (feature < NUM_FEATURES && name != FEATURE_NAMES[feature]) {
+      feature++;
+    }
+    if (feature == NUM_FEATURES) {
+      return false;
+    }
+    weights[feature] = weight;
+  }
+  return true;
+}
+
+void Evaluator::save(std::ostream& os) const {
+  for (int feature = 0; feature < NUM_FEATURES; feature++) {
+    os << FEATURE_NAMES[feature] << " " << weights[feature] << std::endl;
+  }
+}
+
+int Evaluator::weight(Feature feature) const {
+  return weights[feature];
+}
+
+void Evaluator::set_weight(Feature feature, int weight) {
+  weights[feature] = weight;
+}
+
+void Evaluator::features(const Game *game, int player, int *values) const {
+  for (int feature = 0; feature < NUM_FEATURES; feature++) {
+    values[feature] = 0;
+  }
+  values[SMALL_SHIPS] = game->ship_count(player, SMALL);
+  values[MEDIUM_SHIPS] = game->ship_count(player, MEDIUM);
+  values[LARGE_SHIPS] = game->ship_count(player, LARGE);
+
+  int small_colours = 0;
+  for (const auto& it : game->stash()) {
+    if (it.first.size == SMALL && it.second > 0) {
+      small_colours |= 1 << it.first.colour;
+    }
+  }
+
+  int fleet_colours = 0;
+  for (const System& system : game->systems()) {
+    int own = system.ship_types[player];
+    int enemy = 0;
+    for (int other = 0; other <= MAX_PLAYERS; other++) {
+      if (other != player) {
+        enemy |= system.ship_types[other];
+      }
+    }
+    fleet_colours |= mask_colours(own);
+
+    // Ships of size s occupy bits 4s to 4s + 3 of the type masks
+    int own_largest = own == 0 ? 0 : (31 - __builtin_clz(own)) >> 2;
+    int enemy_largest = enemy == 0 ? 0 : (31 - __builtin_clz(enemy)) >> 2;
+    bool enemy_red = (system.star_colours & (1 << RED)) ||
+      (mask_colours(enemy) & (1 << RED));
+    if (enemy_red && enemy_largest > 0) {
+      values[ATTACKABLE_SHIPS] +=
+        __builtin_popcount(own & ((1 << ((enemy_largest + 1) * 4)) - 1));
+    }
+
+    if (system.player == player) {
+      values[HOME_COLOURS] =
+        __builtin_popcount(system.star_colours | mask_colours(own));
+      values[HOME_STAR_SIZES] = __builtin_popcount(system.star_sizes);
+      values[HOME_STAR_COLOURS] = __builtin_popcount(system.star_colours);
+      for (int count : system.colour_counts) {
+        values[HOME_OVERPOPULATION] += count == 3;
+      }
+      values[HOME_INVADERS] =
+        __builtin_popcount(enemy & ~((1 << (own_largest * 4)) - 1));
+    }
+  }
+  values[FLEET_COLOURS] = __builtin_popcount(fleet_colours);
+  values[CHEAP_BUILDS] = __builtin_popcount(fleet_colours & small_colours);
+}
+
+int Evaluator::evaluate(const Game *game, int player) const {
+  int values[NUM_FEATURES];
+  features(game, player, values);
+  int total = 0;
+  for (int feature = 0; feature < NUM_FEATURES; feature++) {
+    total += weights[feature] * values[feature];
+  }
+  return total;
+}
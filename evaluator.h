@@ -0,0 +1,60 @@
+#ifndef EVALUATOR_H
+#define EVALUATOR_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "game.h"
+
+// Features are computed for one player; the evaluation of a position is the
+// weighted difference between the player to move and their opponent.
+enum Feature {
+  SMALL_SHIPS,
+  MEDIUM_SHIPS,
+  LARGE_SHIPS,
+  FLEET_COLOURS, // distinct colours among all ships
+  HOME_COLOURS, // colours available at home from stars and ships
+  HOME_STAR_SIZES, // distinct sizes of homeworld stars
+  HOME_STAR_COLOURS, // distinct colours of homeworld stars
+  HOME_OVERPOPULATION, // colours one piece away from a catastrophe at home
+  CHEAP_BUILDS, // fleet colours with a small pyramid left in the stash
+  ATTACKABLE_SHIPS, // ship types an enemy can attack where they are
+  HOME_INVADERS, // enemy ship types at home at least as large as ours
+  NUM_FEATURES
+};
+
+const static char *const FEATURE_NAMES[NUM_FEATURES] = {
+  "small_ships",
+  "medium_ships",
+  "large_ships",
+  "fleet_colours",
+  "home_colours",
+  "home_star_sizes",
+  "home_star_colours",
+  "home_overpopulation",
+  "cheap_builds",
+  "attackable_ships",
+  "home_invaders"
+};
+
+class Evaluator {
+  public:
+    Evaluator(); // hand-picked default weights
+
+    // Weight files have one "name weight" pair per line; lines starting with
+    // '#' are comments and features that are not listed keep their weight.
+    bool load(std::istream& is); // false on an unknown feature name
+    void save(std::ostream& os) const;
+
+    int weight(Feature feature) const;
+    void set_weight(Feature feature, int weight);
+
+    void features(const Game *game, int player, int *values) const;
+    int evaluate(const Game *game, int player) const;
+
+  private:
+    std::vector<int> weights;
+};
+
+#endif
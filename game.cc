@@ -1,6 +1,8 @@
+#include <cassert>
 #include <set>
 
 #include "game.h"
+#include "trace.h"
 
 #ifdef __linux__ 
   #include <algorithm>
@@ -8,6 +10,16 @@
 
 // Utility
 
+// splitmix64 finalizer
+static unsigned long long mix64(unsigned long long x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
 bool operator==(const Pyramid& lhs, const Pyramid& rhs) {
   return lhs.size == rhs.size && lhs.colour == rhs.colour;
 }
@@ -26,7 +38,8 @@ bool operator==(const Action& lhs, const Action& rhs) {
     lhs.system == rhs.system &&
     lhs.ship == rhs.ship &&
     lhs.system_target == rhs.system_target &&
-    lhs.target == rhs.target;
+    lhs.target == rhs.target &&
+    lhs.star == rhs.star;
 }
 
 bool operator<(const Action& lhs, const Action& rhs) {
@@ -39,6 +52,8 @@ bool operator<(const Action& lhs, const Action& rhs) {
   if (lhs.system_target < rhs.system_target) return true;
   if (lhs.system_target > rhs.system_target) return false;
   if (lhs.target < rhs.target) return true;
+  if (!(lhs.target == rhs.target)) return false;
+  if (lhs.star < rhs.star) return true;
   return false;
 }
 
@@ -51,7 +66,12 @@ Game::Game(int num_players) :
     homeworlds_built_(0),
     next_system_(1),
     sacrifice_actions_(0),
-    sacrifice_colour_(RED) {
+    sacrifice_colour_(RED),
+    ship_counts_(),
+    home_ships_(),
+    network_(nullptr),
+    accumulator_(),
+    systems_key_(0) {
   for (const auto colour : { RED, YELLOW, GREEN, BLUE }) {
     for (const auto size : { SMALL, MEDIUM, LARGE }) {
       Pyramid p { size, colour };
@@ -98,6 +118,14 @@ const std::map<Pyramid, int>& Game::stash() const {
   return stash_;
 }
 
+const NnueNetwork *Game::network() const {
+  return network_;
+}
+
+const NnueAccumulator& Game::accumulator() const {
+  return accumulator_;
+}
+
 // Setters
 
 void Game::set_num_players(int num_players) {
@@ -124,6 +152,13 @@ void Game::set_sacrifice_colour(Colour sacrifice_colour) {
   sacrifice_colour_ = sacrifice_colour;
 }
 
+void Game::set_network(const NnueNetwork *network) {
+  network_ = network;
+  if (network_ != nullptr) {
+    refresh_accumulator(accumulator_);
+  }
+}
+
 // Info
 
 int Game::winner() const {
@@ -131,12 +166,10 @@ int Game::winner() const {
     return 0;
   }
   int w = -1;
-  for (const System& s : systems_) {
-    if (s.player != 0 && find_if(s.ships.begin(), s.ships.end(), [&s](const Ship& ship) {
-            return ship.player == s.player; 
-          }) != s.ships.end()) {
+  for (int player = 1; player <= num_players_; player++) {
+    if (home_ships_[player] > 0) {
       if (w == -1) {
-        w = s.player;
+        w = player;
       } else {
         return 0;
       }
@@ -145,6 +178,19 @@ int Game::winner() const {
   return w;
 }
 
+bool Game::eliminated(int player) const {
+  return homeworlds_built_ >= num_players_ && home_ships_[player] == 0;
+}
+
+int Game::ship_count(int player, Size size) const {
+  return ship_counts_[player][size];
+}
+
+int Game::material(int player) const {
+  return ship_counts_[player][SMALL] + 4 * ship_counts_[player][MEDIUM] +
+    9 * ship_counts_[player][LARGE];
+}
+
 const System& Game::get_system(int id) const {
   for (const System& system : systems_) {
     if (system.id == id) {
@@ -173,6 +219,12 @@ int Game::hash() const {
     (31 * PLAYER_HASH[homeworlds_built_]) ^ (done_main_action_ ? 0xd7067b50 : 0);
 }
 
+unsigned long long Game::key() const {
+  return systems_key_ ^ mix64((unsigned long long)num_players_ << 32 |
+      cur_player_ << 24 | done_main_action_ << 16 | homeworlds_built_ << 8 |
+      sacrifice_actions_ << 4 | sacrifice_colour_);
+}
+
 std::string Game::hash_string() const {
   std::string h = "";
   // maximum compression! fails for more than 7 players
@@ -191,7 +243,127 @@ std::string Game::hash_string() const {
   return h;
 }
 
+// Whether the bank holds the three pyramids of a homeworld
+static bool homeworld_in_stash(const std::map<Pyramid, int>& stash,
+    const Pyramid& a, const Pyramid& b, const Pyramid& ship) {
+  for (const Pyramid& p : {a, b, ship}) {
+    if (stash.at(p) < (p == a) + (p == b) + (p == ship)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool valid_pyramid(const Pyramid& pyramid) {
+  return pyramid.size >= SMALL && pyramid.size <= LARGE &&
+    pyramid.colour >= RED && pyramid.colour <= BLUE;
+}
+
+bool Game::validate_action(const Action& action) const {
+  if (action.player != cur_player_) {
+    return false;
+  }
+  if (action.type == PASS) {
+    return done_main_action_;
+  }
+  if (homeworlds_built_ < num_players_ || action.type == HOMEWORLD) {
+    return action.type == HOMEWORLD && homeworlds_built_ < num_players_ &&
+      !done_main_action_ && valid_pyramid(action.target) &&
+      valid_pyramid(action.star) && valid_pyramid(action.ship) &&
+      action.ship.size == LARGE &&
+      homeworld_in_stash(stash_, action.target, action.star, action.ship);
+  }
+  const auto& system = find_if(systems_.begin(), systems_.end(),
+      [&action](const System& s) {
+        return s.id == action.system;
+      });
+  if (system == systems_.end() || action.ship.colour < RED ||
+      action.ship.colour > BLUE) {
+    return false;
+  }
+  if (action.type == CATASTROPHE) {
+    int ships = 0;
+    for (int player = 1; player <= num_players_; player++) {
+      ships |= system->ship_types[player];
+    }
+    return system->colour_counts[action.ship.colour] >= 4 &&
+      (mask_colours(ships) & (1 << action.ship.colour)) != 0;
+  }
+
+  if (!valid_pyramid(action.ship)) {
+    return false;
+  }
+  int own_ships = system->ship_types[cur_player_];
+  bool has_ship =
+    (own_ships & (1 << (action.ship.size * 4 + action.ship.colour))) != 0;
+  if (action.type == SACRIFICE) {
+    return !done_main_action_ && has_ship;
+  }
+
+  Colour power =
+    action.type == ATTACK ? RED :
+    action.type == DISCOVER || action.type == TRAVEL ? YELLOW :
+    action.type == BUILD ? GREEN : BLUE;
+  if (!((!done_main_action_ && colour_available(*system, cur_player_, power)) ||
+        (sacrifice_actions_ > 0 && sacrifice_colour_ == power))) {
+    return false;
+  }
+
+  switch (action.type) {
+    case ATTACK: {
+        bool enemy_ship = false;
+        for (int player = 1; player <= num_players_; player++) {
+          enemy_ship |= player != cur_player_ && (system->ship_types[player] &
+              (1 << (action.ship.size * 4 + action.ship.colour)));
+        }
+        // own ships of at least the attacked size
+        return enemy_ship && (own_ships >> (action.ship.size * 4)) != 0;
+      }
+
+    case DISCOVER:
+      return has_ship && valid_pyramid(action.target) &&
+        stash_.at(action.target) > 0 && connected(*system, action.target);
+
+    case TRAVEL: {
+        const auto& to_system = find_if(systems_.begin(), systems_.end(),
+            [&action](const System& s) {
+              return s.id == action.system_target;
+            });
+        return has_ship && to_system != systems_.end() &&
+          connected(*system, *to_system);
+      }
+
+    case BUILD:
+      return colour_available(*system, cur_player_, action.ship.colour, false) &&
+        smallest_of_colour(action.ship.colour) == action.ship;
+
+    case TRADE:
+      return has_ship && valid_pyramid(action.target) &&
+        action.target.size == action.ship.size &&
+        action.target.colour != action.ship.colour &&
+        stash_.at(action.target) > 0;
+
+    default:
+      return false;
+  }
+}
+
 void Game::legal_actions(std::vector<Action>& result) const {
+  if (homeworlds_built_ < num_players_ && !done_main_action_) {
+    for (auto a = stash_.begin(); a != stash_.end(); ++a) {
+      for (auto b = a; b != stash_.end(); ++b) {
+        for (Colour colour : { RED, YELLOW, GREEN, BLUE }) {
+          Pyramid ship = Pyramid{LARGE, colour};
+          if (homeworld_in_stash(stash_, a->first, b->first, ship)) {
+            result.push_back(Action{cur_player_, HOMEWORLD, 0, ship, 0,
+                a->first, b->first});
+          }
+        }
+      }
+    }
+    return;
+  }
+
   if (done_main_action_) {
     result.push_back(Action{cur_player_, PASS});
   }
@@ -232,6 +404,7 @@ void Game::legal_system_actions(std::vector<Action>& result,
 
   switch(type) {
     case PASS:
+    case HOMEWORLD: // see legal_actions
       break;
 
     case ATTACK: {
@@ -335,6 +508,7 @@ void Game::legal_system_actions(std::vector<Action>& result,
 // Actions
 
 bool Game::perform_action(Action& action) {
+  TRACE_SCOPE("perform_action");
   if (action.player != cur_player_) {
     return false;
   }
@@ -358,8 +532,8 @@ bool Game::perform_action(Action& action) {
         if (ship == system.ships.end()) {
           return false;
         }
-        remove_ship(action.system, *ship);
-        add_ship(action.system, Ship{action.player, ship->pyramid});
+        Ship attacked = remove_ship(action.system, *ship);
+        add_ship(action.system, Ship{action.player, attacked.pyramid});
         done_main_action_ = true;
       }
       break;
@@ -410,6 +584,15 @@ bool Game::perform_action(Action& action) {
       apply_catastrophe(action.system, action.ship.colour);
       break;
 
+    case HOMEWORLD: {
+        int system_id = create_system({action.target, action.star},
+            action.player);
+        add_ship(system_id, Ship{action.player, action.ship});
+        action.system_target = system_id;
+        done_main_action_ = true;
+      }
+      break;
+
   }
 
   return true;
@@ -418,9 +601,6 @@ bool Game::perform_action(Action& action) {
 // Mutators
 
 int Game::create_system(const std::vector<Pyramid>& stars, int player) {
-  for (const Pyramid& star : stars) {
-    stash_[star]--;
-  }
   if (player != 0) {
     homeworlds_built_++;
   }
@@ -429,7 +609,20 @@ int Game::create_system(const std::vector<Pyramid>& stars, int player) {
 
 int Game::add_system(System system) {
   system.id = next_system_;
+  update_masks(system);
+  systems_key_ += ::key(system);
+  for (const Pyramid& star : system.stars) {
+    stash_[star]--;
+    account_star(system, star, 1);
+  }
+  for (const Ship& ship : system.ships) {
+    stash_[ship.pyramid]--;
+    account_ship(system, ship, 1);
+  }
   systems_.push_back(system);
+#ifdef CHECK_INCREMENTAL
+  check_incremental();
+#endif
   return next_system_++;
 }
 
@@ -440,11 +633,17 @@ void Game::destroy_system(int system_id) {
       });
   for (const Pyramid& star : it->stars) {
     stash_[star]++;
+    account_star(*it, star, -1);
   }
   for (const Ship& ship : it->ships) {
     stash_[ship.pyramid]++;
+    account_ship(*it, ship, -1);
   }
+  systems_key_ -= ::key(*it);
   systems_.erase(it);
+#ifdef CHECK_INCREMENTAL
+  check_incremental();
+#endif
 }
 
 void Game::add_ship(int system_id, const Ship& ship) {
@@ -454,9 +653,15 @@ void Game::add_ship(int system_id, const Ship& ship) {
       });
   it->ships.push_back(ship);
   stash_[ship.pyramid]--;
+  account_ship(*it, ship, 1);
+  refresh_system(*it);
+#ifdef CHECK_INCREMENTAL
+  check_incremental();
+#endif
 }
 
-Ship Game::remove_ship(int system_id, const Ship& ship) {
+Ship Game::remove_ship(int system_id, const Ship& to_remove) {
+  const Ship ship = to_remove; // to_remove may be the element erased below
   auto system = find_if(systems_.begin(), systems_.end(),
       [system_id](const System& s) {
         return s.id == system_id;
@@ -467,8 +672,13 @@ Ship Game::remove_ship(int system_id, const Ship& ship) {
       });
   if (it != system->ships.end()) {
     stash_[ship.pyramid]++;
+    account_ship(*system, ship, -1);
     system->ships.erase(it);
+    refresh_system(*system);
   }
+#ifdef CHECK_INCREMENTAL
+  check_incremental();
+#endif
   return ship;
 }
 
@@ -477,26 +687,34 @@ void Game::apply_catastrophe(int system_id, Colour colour) {
       [system_id](const System& system) {
         return system.id == system_id;
       });
-  const auto& stars_end = std::remove_if(it->stars.begin(), it->stars.end(),
-        [colour](const Pyramid& pyramid) {
-          return pyramid.colour == colour;
+  // Partitioned rather than removed, so the tail holds the destroyed pieces
+  // to account for
+  const auto& stars_end = std::stable_partition(it->stars.begin(),
+        it->stars.end(), [colour](const Pyramid& pyramid) {
+          return pyramid.colour != colour;
         });
-  std::for_each(stars_end, it->stars.end(), [this](const Pyramid& pyramid) {
+  std::for_each(stars_end, it->stars.end(), [this, &it](const Pyramid& pyramid) {
         this->stash_[pyramid]++;
+        this->account_star(*it, pyramid, -1);
       });
   it->stars.erase(stars_end, it->stars.end());
-  const auto& ships_end = std::remove_if(it->ships.begin(), it->ships.end(),
-        [colour](const Ship& ship) {
-          return ship.pyramid.colour == colour;
+  const auto& ships_end = std::stable_partition(it->ships.begin(),
+        it->ships.end(), [colour](const Ship& ship) {
+          return ship.pyramid.colour != colour;
         });
-  std::for_each(ships_end, it->ships.end(), [this](const Ship& ship) {
+  std::for_each(ships_end, it->ships.end(), [this, &it](const Ship& ship) {
         this->stash_[ship.pyramid]++;
+        this->account_ship(*it, ship, -1);
       });
   it->ships.erase(ships_end, it->ships.end());
+  refresh_system(*it);
 
   if (it->stars.size() == 0 || it->ships.size() == 0) {
     destroy_system(system_id);
   }
+#ifdef CHECK_INCREMENTAL
+  check_incremental();
+#endif
 }
 
 void Game::advance_cur_player() {
@@ -504,49 +722,172 @@ void Game::advance_cur_player() {
   if (winner() == 0) {
     done_main_action_ = false;
     sacrifice_actions_ = 0;
-    // TODO: handle eliminated players in games with more than two players
+    for (int i = 1; i < num_players_ && eliminated(cur_player_); i++) {
+      cur_player_ = (cur_player_ % num_players_) + 1;
+    }
   }
 }
 
-// Utility
-
-bool connected(const System& a, const System& b) {
-  for (const Pyramid& star : a.stars) {
-    for (const Pyramid& star2 : b.stars) {
-      if (star.size == star2.size) {
-        return false;
+void Game::check_incremental() const {
+  int ship_counts[MAX_PLAYERS + 1][4] = {{0}};
+  int home_ships[MAX_PLAYERS + 1] = {0};
+  for (const System& system : systems_) {
+    for (const Ship& ship : system.ships) {
+      ship_counts[ship.player][ship.pyramid.size]++;
+      if (ship.player == system.player) {
+        home_ships[ship.player]++;
       }
     }
   }
-  return true;
+  unsigned long long systems_key = 0;
+  for (const System& system : systems_) {
+    System copy = system;
+    update_masks(copy);
+    systems_key += ::key(copy);
+    assert(copy.contents == system.contents);
+    assert(copy.star_sizes == system.star_sizes);
+    assert(copy.star_colours == system.star_colours);
+    for (int player = 0; player <= MAX_PLAYERS; player++) {
+      assert(copy.ship_types[player] == system.ship_types[player]);
+    }
+    for (int colour = 0; colour < 4; colour++) {
+      assert(copy.colour_counts[colour] == system.colour_counts[colour]);
+    }
+  }
+  assert(systems_key == systems_key_);
+  if (network_ != nullptr) {
+    NnueAccumulator accumulator;
+    refresh_accumulator(accumulator);
+    for (int player = 0; player < 2; player++) {
+      for (int i = 0; i < NNUE_HIDDEN; i++) {
+        assert(accumulator.values[player][i] == accumulator_.values[player][i]);
+      }
+    }
+  }
+  for (int player = 0; player <= MAX_PLAYERS; player++) {
+    assert(home_ships[player] == home_ships_[player]);
+    for (int size = 0; size < 4; size++) {
+      assert(ship_counts[player][size] == ship_counts_[player][size]);
+    }
+  }
 }
 
-bool connected(const System& a, const Pyramid& b) {
-  for (const Pyramid& star : a.stars) {
-    if (star.size == b.size) {
-      return false;
+static SystemRole role(const System& system, int player) {
+  return system.player == player ? OWN_HOME :
+    system.player != 0 ? ENEMY_HOME : COLONY;
+}
+
+void Game::account_ship(const System& system, const Ship& ship, int sign) {
+  ship_counts_[ship.player][ship.pyramid.size] += sign;
+  if (ship.player == system.player) {
+    home_ships_[ship.player] += sign;
+  }
+  if (network_ != nullptr) {
+    for (int player = 1; player <= 2; player++) {
+      account_feature(player, nnue_ship_feature(ship.pyramid.size,
+            ship.pyramid.colour, ship.player == player, role(system, player)),
+          sign);
     }
   }
-  return true;
 }
 
-bool colour_available(const System& system, int player, Colour colour,
-    bool include_stars) {
-  if (include_stars) {
-    for (const Pyramid& star : system.stars) {
-      if (star.colour == colour) {
-        return true;
+void Game::account_star(const System& system, const Pyramid& star, int sign) {
+  if (network_ != nullptr) {
+    for (int player = 1; player <= 2; player++) {
+      account_feature(player,
+          nnue_star_feature(star.size, star.colour, role(system, player)), sign);
+    }
+  }
+}
+
+void Game::account_feature(int player, int feature, int sign) {
+  short *values = accumulator_.values[player - 1];
+  const short *weights = network_->input_weights[feature];
+  for (int i = 0; i < NNUE_HIDDEN; i++) {
+    values[i] += sign * weights[i];
+  }
+}
+
+void Game::refresh_system(System& system) {
+  systems_key_ -= ::key(system);
+  update_masks(system);
+  systems_key_ += ::key(system);
+}
+
+void Game::refresh_accumulator(NnueAccumulator& accumulator) const {
+  for (int player = 1; player <= 2; player++) {
+    short *values = accumulator.values[player - 1];
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+      values[i] = network_->input_bias[i];
+    }
+    for (const System& system : systems_) {
+      for (const Pyramid& star : system.stars) {
+        const short *weights = network_->input_weights[
+          nnue_star_feature(star.size, star.colour, role(system, player))];
+        for (int i = 0; i < NNUE_HIDDEN; i++) {
+          values[i] += weights[i];
+        }
+      }
+      for (const Ship& ship : system.ships) {
+        const short *weights = network_->input_weights[
+          nnue_ship_feature(ship.pyramid.size, ship.pyramid.colour,
+              ship.player == player, role(system, player))];
+        for (int i = 0; i < NNUE_HIDDEN; i++) {
+          values[i] += weights[i];
+        }
       }
     }
   }
+}
 
+// Utility
+
+void update_masks(System& system) {
+  system.star_sizes = 0;
+  system.star_colours = 0;
+  for (int& types : system.ship_types) {
+    types = 0;
+  }
+  for (int& count : system.colour_counts) {
+    count = 0;
+  }
+  system.contents = mix64(0x100 | system.player);
+  for (const Pyramid& star : system.stars) {
+    system.star_sizes |= 1 << star.size;
+    system.star_colours |= 1 << star.colour;
+    system.colour_counts[star.colour]++;
+    system.contents += mix64(0x200 | hash_string(star));
+  }
   for (const Ship& ship : system.ships) {
-    if (ship.player == player && ship.pyramid.colour == colour) {
-      return true;
-    }
+    system.ship_types[ship.player] |=
+      1 << (ship.pyramid.size * 4 + ship.pyramid.colour);
+    system.colour_counts[ship.pyramid.colour]++;
+    system.contents += mix64(0x300 | (unsigned char)hash_string(ship));
   }
+}
 
-  return false;
+int mask_colours(int ship_types) {
+  return (ship_types | ship_types >> 4 | ship_types >> 8 | ship_types >> 12) & 0xf;
+}
+
+bool connected(const System& a, const System& b) {
+  return (a.star_sizes & b.star_sizes) == 0;
+}
+
+bool connected(const System& a, const Pyramid& b) {
+  return (a.star_sizes & (1 << b.size)) == 0;
+}
+
+bool colour_available(const System& system, int player, Colour colour,
+    bool include_stars) {
+  if (include_stars && (system.star_colours & (1 << colour))) {
+    return true;
+  }
+  return (mask_colours(system.ship_types[player]) & (1 << colour)) != 0;
+}
+
+unsigned long long key(const System& system) {
+  return mix64(system.contents);
 }
 
 int hash(const System& system) {
@@ -6,6 +6,10 @@
 #include <string>
 #include <vector>
 
+#include "nnue.h"
+
+const static int MAX_PLAYERS = 7;
+
 enum Size { ZERO = 0, SMALL, MEDIUM, LARGE };
 enum Colour { RED = 0, YELLOW, GREEN, BLUE };
 
@@ -29,6 +33,13 @@ struct System {
   int player; // 0 if not homeworld
   std::vector<Pyramid> stars;
   std::vector<Ship> ships;
+
+  // Cached by Game (see update_masks) whenever stars or ships change
+  int star_sizes; // bit per Size
+  int star_colours; // bit per Colour
+  int ship_types[MAX_PLAYERS + 1]; // bit (size * 4 + colour) per player
+  int colour_counts[4]; // stars and ships of each Colour
+  unsigned long long contents; // sum of piece codes, see key(const System&)
 };
 
 enum ActionType {
@@ -39,7 +50,8 @@ enum ActionType {
   BUILD,
   TRADE,
   SACRIFICE,
-  CATASTROPHE
+  CATASTROPHE,
+  HOMEWORLD // setup: create the homeworld with a large ship
 };
 
 struct Action {
@@ -48,8 +60,9 @@ struct Action {
   int system; // all
   Pyramid ship; // all
   // TODO: in games with more than two players, ship can be ambiguous in ATTACKs
-  int system_target; // TRAVEL
-  Pyramid target; // TRADE, DISCOVER
+  int system_target; // TRAVEL; set to the new system by DISCOVER, HOMEWORLD
+  Pyramid target; // TRADE, DISCOVER, HOMEWORLD (first star)
+  Pyramid star; // HOMEWORLD (second star)
 };
 
 bool operator==(const Action& lhs, const Action& rhs);
@@ -57,7 +70,8 @@ bool operator<(const Action& lhs, const Action& rhs);
 
 const static unsigned int SIZE_HASH[] = {0x96ef527d, 0xbf6ff0bb, 0x55742d1e, 0x12972d93};
 const static unsigned int COLOUR_HASH[] = {0x7fd9fd6a, 0x8dd08654, 0x29f99b21, 0x3a707ca3};
-const static unsigned int PLAYER_HASH[] = {0x3e624de3, 0x1a9e20e1, 0x52c25952};
+const static unsigned int PLAYER_HASH[] = {0x3e624de3, 0x1a9e20e1, 0x52c25952,
+  0xc6a4a793, 0x5851f42d, 0x4c957f2d, 0x9b1e8a63, 0x27bb2ee6};
 const static unsigned int STARS_HASH = 0xd9a110c5;
 const static unsigned int SHIPS_HASH = 0x12ec3a54;
 
@@ -76,6 +90,8 @@ class Game {
   Colour sacrifice_colour() const;
   const std::vector<System>& systems() const;
   const std::map<Pyramid, int>& stash() const;
+  const NnueNetwork *network() const; // nullptr unless set
+  const NnueAccumulator& accumulator() const;
   
   // Setters (testing only)
   void set_num_players(int num_players);
@@ -85,13 +101,28 @@ class Game {
   void set_sacrifice_actions(int sacrifice_actions);
   void set_sacrifice_colour(Colour sacrifice_colour);
 
+  // Starts maintaining NNUE accumulators for network (nullptr to stop)
+  void set_network(const NnueNetwork *network);
+
   // Info
   int winner() const; // 0 if game not complete, -1 if tie
+  bool eliminated(int player) const;
+  int ship_count(int player, Size size) const;
+  int material(int player) const; // sum of squared ship sizes
   const System& get_system(int id) const;
   Pyramid smallest_of_colour(Colour colour) const;
   int hash() const;
+  unsigned long long key() const; // 64-bit, maintained incrementally
   std::string hash_string() const;
 
+  // Checks every rule for action against the cached system masks, without
+  // generating the legal actions. True exactly when action is among
+  // legal_actions, except that catastrophes are checked by colour only and
+  // homeworld stars may come in either order.
+  // perform_action does not call it, so search is not slowed down.
+  bool validate_action(const Action& action) const;
+  // While homeworlds_built() < num_players() the player to move creates a
+  // homeworld (two stars, target <= star, and a large ship) and passes
   void legal_actions(std::vector<Action>& result) const;
   void legal_system_actions(std::vector<Action>& result, const System& system,
       ActionType type) const;
@@ -108,6 +139,10 @@ class Game {
   void apply_catastrophe(int system_id, Colour colour);
   void advance_cur_player();
 
+  // Recomputes the incrementally maintained counts and asserts that they
+  // match. Called after every mutation when built with -DCHECK_INCREMENTAL.
+  void check_incremental() const;
+
  private:
   int num_players_;
   int cur_player_;
@@ -118,15 +153,34 @@ class Game {
   Colour sacrifice_colour_;
   std::vector<System> systems_;
   std::map<Pyramid, int> stash_;
+
+  // Maintained by add_ship, remove_ship, add_system, destroy_system and
+  // apply_catastrophe
+  int ship_counts_[MAX_PLAYERS + 1][4]; // by player and size
+  int home_ships_[MAX_PLAYERS + 1]; // ships players have in their homeworld
+  const NnueNetwork *network_;
+  NnueAccumulator accumulator_;
+  unsigned long long systems_key_; // sum of the systems' keys
+
+  void account_ship(const System& system, const Ship& ship, int sign);
+  void account_star(const System& system, const Pyramid& star, int sign);
+  void account_feature(int player, int feature, int sign);
+  void refresh_accumulator(NnueAccumulator& accumulator) const;
+  void refresh_system(System& system); // after its stars or ships change
 };
 
 // Utility
 
+void update_masks(System& system);
+int mask_colours(int ship_types); // bit per Colour present in ship_types
+
 bool connected(const System& a, const System& b);
 bool connected(const System& a, const Pyramid& b);
 bool colour_available(const System& system, int player, Colour colour,
     bool include_stars = true);
 
+unsigned long long key(const System& system); // independent of id
+
 int hash(const System& system);
 int hash(const Ship& ship);
 int hash(const Pyramid& pyramid);
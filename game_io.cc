@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <set>
 #include <sstream>
 
 #include "game_io.h"
@@ -64,6 +66,11 @@ std::ostream& operator<<(std::ostream& os, const Action& action) {
       os << "CATASTROPHE " << action.system;
       os << " " << "rygb"[action.ship.colour];
       break;
+
+    case HOMEWORLD:
+      os << "HOMEWORLD " << action.target << " " << action.star;
+      os << " " << action.ship;
+      break;
   }
   return os;
 }
@@ -108,6 +115,50 @@ void print_action(std::ostream& os, const Action& action,
       os << "CATASTROPHE " << system_names.at(action.system);
       os << " " << "rygb"[action.ship.colour];
       break;
+
+    case HOMEWORLD:
+      os << "HOMEWORLD " << action.target << " " << action.star;
+      os << " " << action.ship << " " << *new_names++;
+      break;
+  }
+}
+
+static std::string new_system_name(const std::map<int, std::string>& system_names,
+                                   int player = 0) {
+  static const char *NAMES[] = {"Sirius", "AlphaCentauri", "Mars", "Venus"};
+  std::set<std::string> used;
+  for (const auto& it : system_names) {
+    used.insert(it.second);
+  }
+  if (player != 0 && used.count("Home" + std::to_string(player)) == 0) {
+    return "Home" + std::to_string(player);
+  }
+  for (const char *name : NAMES) {
+    if (used.count(name) == 0) {
+      return name;
+    }
+  }
+  for (int i = 1; ; i++) {
+    std::string name = "System" + std::to_string(i);
+    if (used.count(name) == 0) {
+      return name;
+    }
+  }
+}
+
+void print_turn(std::ostream& os, Game& game, const std::vector<Action>& actions,
+                std::map<int, std::string>& system_names) {
+  for (Action a : actions) {
+    game.perform_action(a); // fills in the id of a new system
+    std::vector<std::string> new_names;
+    if (a.type == DISCOVER || a.type == HOMEWORLD) {
+      new_names.push_back(new_system_name(system_names,
+            a.type == HOMEWORLD ? a.player : 0));
+      system_names.emplace(a.system_target, new_names[0]);
+    }
+    auto new_names_it = new_names.begin();
+    print_action(os, a, system_names, new_names_it);
+    os << std::endl;
   }
 }
 
@@ -168,28 +219,62 @@ std::istream& operator>>(std::istream& is, System& system) {
   return is;
 }
 
+bool valid_header(int num_players, int homeworlds_built, int cur_player) {
+  return num_players >= 1 && num_players <= MAX_PLAYERS &&
+    homeworlds_built >= 0 && homeworlds_built <= num_players &&
+    cur_player >= 1 && cur_player <= num_players;
+}
+
+static bool valid_size(Size size) {
+  return size >= SMALL && size <= LARGE;
+}
+
+bool valid_system(const System& system, int num_players) {
+  if (system.player < 0 || system.player > num_players) {
+    return false;
+  }
+  for (const Pyramid& star : system.stars) {
+    if (!valid_size(star.size)) {
+      return false;
+    }
+  }
+  for (const Ship& ship : system.ships) {
+    if (ship.player < 1 || ship.player > num_players ||
+        !valid_size(ship.pyramid.size)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 Game* read_game(std::istream& is, std::map<int, std::string>& system_names) {
-  int num_players, homeworlds_built, cur_player;
+  int num_players = 0, homeworlds_built = 0, cur_player = 0;
   std::string line;
   is >> num_players >> homeworlds_built >> cur_player;
   std::getline(is, line);
-  Game *g = new Game(num_players);
-  g->set_homeworlds_built(homeworlds_built);
-  g->set_cur_player(cur_player);
-  while (true) {
-    std::getline(is, line);
-    if (line.length() == 0) {
-      break;
-    }
+  bool valid = valid_header(num_players, homeworlds_built, cur_player);
+  Game *g = valid ? new Game(num_players) : nullptr;
+  if (valid) {
+    g->set_homeworlds_built(homeworlds_built);
+    g->set_cur_player(cur_player);
+  }
+  while (std::getline(is, line) && line.length() > 0) {
     System system;
     std::istringstream sis = std::istringstream(line);
     std::string system_name;
     sis >> system_name;
     sis >> system;
-    int system_id = g->add_system(system);
-    system_names.emplace(system_id, system_name);
+    valid = valid && valid_system(system, num_players);
+    if (valid) {
+      int system_id = g->add_system(system);
+      system_names.emplace(system_id, system_name);
+    }
   }
 
+  if (!valid) {
+    delete g;
+    return nullptr;
+  }
   return g;
 }
 
@@ -256,6 +341,16 @@ std::string read_action(std::istream& is, Action& action,
     } else {
       action.ship = Pyramid{ZERO, BLUE};
     }
+  } else if (type == "HOMEWORLD") {
+    action.type = HOMEWORLD;
+    is >> action.target;
+    is >> action.star;
+    if (action.star < action.target) {
+      std::swap(action.target, action.star);
+    }
+    is >> action.ship;
+    is >> system_name;
+    return system_name;
   }
 
   return "";
@@ -14,12 +14,20 @@ std::ostream& operator<<(std::ostream& os, const Action& action);
 void print_action(std::ostream& os, const Action& action,
                   const std::map<int, std::string>& system_names,
                   std::vector<std::string>::iterator& new_names);
+// Prints the actions of a turn one per line and performs them on game. Systems
+// created by DISCOVER actions are given names not already in system_names.
+void print_turn(std::ostream& os, Game& game, const std::vector<Action>& actions,
+                std::map<int, std::string>& system_names);
 void print_game(std::ostream& os, const Game& game,
                 const std::map<int, std::string>& system_names);
 
 std::istream& operator>>(std::istream& is, Ship& ship);
 std::istream& operator>>(std::istream& is, System& system);
+// Returns nullptr, after reading the whole game, if it is malformed: more
+// than MAX_PLAYERS players, or a player or size out of range
 Game* read_game(std::istream& is, std::map<int, std::string>& system_names);
+bool valid_header(int num_players, int homeworlds_built, int cur_player);
+bool valid_system(const System& system, int num_players);
 std::string read_action(std::istream& is, Action& action,
                         std::map<int, std::string>& system_names);
 
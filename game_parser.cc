@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "game_io.h"
+#include "game_parser.h"
+
+std::string NameRef::str() const {
+  return std::string(begin, length);
+}
+
+GameParser::GameParser(const char *begin, const char *end) :
+    p(begin), end(end) {}
+
+bool GameParser::done() {
+  skip_whitespace();
+  return p == end;
+}
+
+const char *GameParser::position() const {
+  return p;
+}
+
+void GameParser::skip_whitespace() {
+  while (p < end && std::isspace((unsigned char)*p)) {
+    p++;
+  }
+}
+
+bool GameParser::read_int(int& value) {
+  skip_whitespace();
+  bool negative = p < end && *p == '-';
+  if (p < end && (*p == '-' || *p == '+')) {
+    p++;
+  }
+  if (p == end || !std::isdigit((unsigned char)*p)) {
+    return false;
+  }
+  value = 0;
+  while (p < end && std::isdigit((unsigned char)*p)) {
+    value = value * 10 + (*p++ - '0');
+  }
+  value = negative ? -value : value;
+  return true;
+}
+
+NameRef GameParser::read_token() {
+  skip_whitespace();
+  const char *begin = p;
+  while (p < end && !std::isspace((unsigned char)*p)) {
+    p++;
+  }
+  return NameRef{begin, (int)(p - begin)};
+}
+
+Pyramid GameParser::read_pyramid() {
+  skip_whitespace();
+  char c = p < end ? *p++ : ' ';
+  Pyramid pyramid;
+  pyramid.colour =
+    c == 'r' || c == 'R' ? RED :
+    c == 'y' || c == 'Y' ? YELLOW :
+    c == 'g' || c == 'G' ? GREEN : BLUE;
+  int size = 0;
+  read_int(size);
+  pyramid.size = (Size)size;
+  return pyramid;
+}
+
+int GameParser::lookup(NameRef name) const {
+  for (const auto& entry : names) {
+    if (entry.first.length == name.length &&
+        std::memcmp(entry.first.begin, name.begin, name.length) == 0) {
+      return entry.second;
+    }
+  }
+  return 0;
+}
+
+void GameParser::add_name(int id, NameRef name) {
+  names.push_back(std::make_pair(name, id));
+}
+
+Game *GameParser::read_game(std::map<int, std::string> *system_names) {
+  int num_players = 0, homeworlds_built = 0, cur_player = 0;
+  read_int(num_players);
+  read_int(homeworlds_built);
+  read_int(cur_player);
+  while (p < end && *p++ != '\n') {} // rest of the line
+
+  bool valid = valid_header(num_players, homeworlds_built, cur_player);
+  Game *g = valid ? new Game(num_players) : nullptr;
+  if (valid) {
+    g->set_homeworlds_built(homeworlds_built);
+    g->set_cur_player(cur_player);
+  }
+  names.clear();
+  while (p < end && *p != '\n') {
+    const char *line_end = (const char*)std::memchr(p, '\n', end - p);
+    line_end = line_end == nullptr ? end : line_end;
+    const char *saved_end = end;
+    end = line_end; // parse within the line
+
+    NameRef name = read_token();
+    System system;
+    system.player = 0;
+    system.id = 0;
+    skip_whitespace();
+    p = p < end ? p + 1 : p; // (
+    if (p < end && std::isdigit((unsigned char)*p)) {
+      read_int(system.player);
+      while (p < end && *p++ != ' ') {}
+    }
+    while (p < end && *p != ')') {
+      system.stars.push_back(read_pyramid());
+    }
+    p = p < end ? p + 1 : p; // )
+    while (!done()) {
+      Ship ship;
+      ship.player = *p++ - '0';
+      ship.pyramid = read_pyramid();
+      system.ships.push_back(ship);
+    }
+
+    end = saved_end;
+    p = line_end < end ? line_end + 1 : end;
+    valid = valid && valid_system(system, num_players);
+    if (valid) {
+      int system_id = g->add_system(system);
+      add_name(system_id, name);
+      if (system_names != nullptr) {
+        system_names->emplace(system_id, name.str());
+      }
+    }
+  }
+  if (p < end) {
+    p++; // the blank line
+  }
+  if (!valid) {
+    delete g;
+    return nullptr;
+  }
+  return g;
+}
+
+NameRef GameParser::read_action(Action& action) {
+  NameRef type = read_token();
+  auto is = [&type](const char *word) {
+    return type.length == (int)std::strlen(word) &&
+      std::memcmp(type.begin, word, type.length) == 0;
+  };
+
+  if (is("PASS")) {
+    action.type = PASS;
+  } else if (is("ATTACK")) {
+    action.type = ATTACK;
+    action.ship = read_pyramid();
+    action.system = lookup(read_token());
+  } else if (is("DISCOVER")) {
+    action.type = DISCOVER;
+    action.ship = read_pyramid();
+    action.system = lookup(read_token());
+    action.target = read_pyramid();
+    return read_token();
+  } else if (is("MOVE")) {
+    action.type = TRAVEL;
+    action.ship = read_pyramid();
+    action.system = lookup(read_token());
+    action.system_target = lookup(read_token());
+  } else if (is("BUILD")) {
+    action.type = BUILD;
+    action.ship = read_pyramid();
+    action.system = lookup(read_token());
+  } else if (is("TRADE")) {
+    action.type = TRADE;
+    action.ship = read_pyramid();
+    action.target = read_pyramid();
+    action.system = lookup(read_token());
+  } else if (is("SACRIFICE")) {
+    action.type = SACRIFICE;
+    action.ship = read_pyramid();
+    action.system = lookup(read_token());
+  } else if (is("CATASTROPHE")) {
+    action.type = CATASTROPHE;
+    action.system = lookup(read_token());
+    NameRef colour = read_token();
+    char c = colour.length == 1 ? colour.begin[0] : ' ';
+    action.ship = Pyramid{ZERO,
+      c == 'r' || c == 'R' ? RED :
+      c == 'y' || c == 'Y' ? YELLOW :
+      c == 'g' || c == 'G' ? GREEN : BLUE};
+  } else if (is("HOMEWORLD")) {
+    action.type = HOMEWORLD;
+    action.target = read_pyramid();
+    action.star = read_pyramid();
+    if (action.star < action.target) {
+      std::swap(action.target, action.star);
+    }
+    action.ship = read_pyramid();
+    return read_token();
+  }
+
+  return NameRef{p, 0};
+}
@@ -0,0 +1,51 @@
+#ifndef GAME_PARSER_H
+#define GAME_PARSER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "game.h"
+
+// Parses the game text format of game_io.h straight out of a character
+// buffer, in one pass and without iostreams. System names are kept in an
+// index that lives as long as the parser, pointing into the buffer, so the
+// buffer must outlive the parser. Results are the same as read_game and
+// read_action.
+
+struct NameRef {
+  const char *begin;
+  int length;
+
+  std::string str() const;
+};
+
+class GameParser {
+  public:
+    GameParser(const char *begin, const char *end);
+
+    bool done(); // true if only whitespace is left
+    bool read_int(int& value); // skips leading whitespace
+    const char *position() const; // next character to be read
+
+    // Resets the name index to the systems of the new game. If system_names
+    // is given it is filled in as by read_game. Like read_game, returns
+    // nullptr for a malformed game, having skipped it.
+    Game *read_game(std::map<int, std::string> *system_names = nullptr);
+    // Returns the name of the new system of a DISCOVER, which should be
+    // given to add_name once the action has been performed
+    NameRef read_action(Action& action);
+    void add_name(int id, NameRef name);
+
+  private:
+    const char *p;
+    const char *end;
+    std::vector<std::pair<NameRef, int> > names; // name, system id
+
+    void skip_whitespace();
+    NameRef read_token();
+    Pyramid read_pyramid();
+    int lookup(NameRef name) const;
+};
+
+#endif
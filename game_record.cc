@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "game_io.h"
+#include "game_record.h"
+
+const static int HEADER_SIZE = 24;
+const static int GAME_HEADER_SIZE = 10;
+
+static int system_index(const Game& game, int id) {
+  const std::vector<System>& systems = game.systems();
+  for (unsigned int i = 0; i < systems.size(); i++) {
+    if (systems[i].id == id) {
+      return i;
+    }
+  }
+  return 0;
+}
+
+static unsigned int pack_pyramid(const Pyramid& pyramid) {
+  return pyramid.size * 4 + pyramid.colour;
+}
+
+static Pyramid unpack_pyramid(unsigned int bits) {
+  return Pyramid{(Size)((bits >> 2) & 3), (Colour)(bits & 3)};
+}
+
+unsigned int pack_action(const Action& action, const Game& game) {
+  unsigned int packed = (action.type & 7) | (action.type >> 3) << 26;
+  packed |= (action.player & 7) << 3;
+  if (action.type == PASS) {
+    return packed;
+  } else if (action.type == HOMEWORLD) {
+    packed |= pack_pyramid(action.star) << 6;
+  } else {
+    packed |= (system_index(game, action.system) & 63) << 6;
+  }
+  packed |= pack_pyramid(action.ship) << 12;
+  if (action.type == TRAVEL) {
+    packed |= (system_index(game, action.system_target) & 63) << 16;
+  }
+  packed |= pack_pyramid(action.target) << 22;
+  return packed;
+}
+
+Action unpack_action(unsigned int packed, const Game& game) {
+  const std::vector<System>& systems = game.systems();
+  Action action = Action{(int)((packed >> 3) & 7),
+    (ActionType)((packed & 7) | ((packed >> 26) & 1) << 3)};
+  if (action.type == PASS) {
+    return action;
+  }
+  unsigned int index = (packed >> 6) & 63;
+  if (action.type == HOMEWORLD) {
+    action.star = unpack_pyramid(index);
+  } else {
+    action.system = index < systems.size() ? systems[index].id : 0;
+  }
+  action.ship = unpack_pyramid(packed >> 12);
+  if (action.type == TRAVEL) {
+    index = (packed >> 16) & 63;
+    action.system_target = index < systems.size() ? systems[index].id : 0;
+  }
+  action.target = unpack_pyramid(packed >> 22);
+  return action;
+}
+
+static void write_u8(std::ostream& os, unsigned int value) {
+  os.put((char)value);
+}
+
+static void write_u32(std::ostream& os, unsigned int value) {
+  for (int i = 0; i < 4; i++) {
+    os.put((char)(value >> (8 * i)));
+  }
+}
+
+static void write_u64(std::ostream& os, unsigned long long value) {
+  for (int i = 0; i < 8; i++) {
+    os.put((char)(value >> (8 * i)));
+  }
+}
+
+static unsigned long long read_u64(const unsigned char *p) {
+  unsigned long long value = 0;
+  for (int i = 7; i >= 0; i--) {
+    value = value << 8 | p[i];
+  }
+  return value;
+}
+
+GameRecordWriter::GameRecordWriter(std::ostream& os) : os(os) {
+  os.write("HWGR", 4);
+  write_u32(os, GAME_RECORD_VERSION);
+  write_u64(os, 0); // patched by finish
+  write_u64(os, 0);
+}
+
+void GameRecordWriter::add(const Game& initial,
+                           const std::vector<Action>& actions, int winner,
+                           int label) {
+  offsets.push_back(os.tellp());
+  write_u8(os, initial.num_players());
+  write_u8(os, initial.homeworlds_built());
+  write_u8(os, initial.cur_player());
+  write_u8(os, std::max(winner, 0)); // a tie (-1) is stored as a draw
+  write_u8(os, label);
+  write_u8(os, initial.systems().size());
+  write_u32(os, actions.size());
+  for (const System& system : initial.systems()) {
+    write_u8(os, system.player);
+    write_u8(os, system.stars.size());
+    write_u8(os, system.ships.size());
+    for (const Pyramid& star : system.stars) {
+      write_u8(os, pack_pyramid(star));
+    }
+    for (const Ship& ship : system.ships) {
+      write_u8(os, ship.player << 4 | pack_pyramid(ship.pyramid));
+    }
+  }
+
+  Game game(initial);
+  for (Action action : actions) {
+    write_u32(os, pack_action(action, game));
+    game.perform_action(action);
+  }
+}
+
+void GameRecordWriter::finish() {
+  unsigned long long index_offset = os.tellp();
+  for (unsigned long long offset : offsets) {
+    write_u64(os, offset);
+  }
+  os.seekp(8);
+  write_u64(os, offsets.size());
+  write_u64(os, index_offset);
+  os.seekp(0, std::ios::end);
+  os.flush();
+}
+
+// Reads the header and systems of the game record at p, adding the systems
+// to game unless it is null. Returns the start of the packed actions, or
+// nullptr if the record is out of range or runs past end.
+static const unsigned char *read_systems(const unsigned char *p,
+                                         const unsigned char *end,
+                                         Game *game) {
+  if (end - p < GAME_HEADER_SIZE || !valid_header(p[0], p[1], p[2]) ||
+      p[3] > p[0]) {
+    return nullptr;
+  }
+  int num_players = p[0];
+  int num_systems = p[5];
+  unsigned long long num_actions = GameRecordReader::read_u32(p + 6);
+  p += GAME_HEADER_SIZE;
+  for (int i = 0; i < num_systems; i++) {
+    if (end - p < 3 || end - p - 3 < p[1] + p[2]) {
+      return nullptr;
+    }
+    System system;
+    system.id = 0;
+    system.player = p[0];
+    int stars = p[1];
+    int ships = p[2];
+    p += 3;
+    for (int s = 0; s < stars; s++) {
+      system.stars.push_back(unpack_pyramid(*p++));
+    }
+    for (int s = 0; s < ships; s++) {
+      system.ships.push_back(Ship{*p >> 4, unpack_pyramid(*p)});
+      p++;
+    }
+    if (!valid_system(system, num_players)) {
+      return nullptr;
+    }
+    if (game != nullptr) {
+      game->add_system(system);
+    }
+  }
+  if (num_actions > (unsigned long long)(end - p) / 4 ||
+      num_actions > 0x7fffffff) {
+    return nullptr;
+  }
+  return p;
+}
+
+GameRecordReader::GameRecordReader() :
+    data(nullptr), size(0), count(0), index(nullptr) {}
+
+GameRecordReader::~GameRecordReader() {
+  if (data != nullptr) {
+    munmap((void*)data, size);
+  }
+}
+
+bool GameRecordReader::open(const std::string& filename) {
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < HEADER_SIZE) {
+    close(fd);
+    return false;
+  }
+  void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+  data = (const unsigned char*)mapped;
+  size = st.st_size;
+
+  count = read_u64(data + 8);
+  unsigned long long index_offset = read_u64(data + 16);
+  if (std::memcmp(data, "HWGR", 4) != 0 ||
+      read_u32(data + 4) != GAME_RECORD_VERSION ||
+      index_offset < HEADER_SIZE || index_offset > size ||
+      count > (size - index_offset) / 8) {
+    munmap(mapped, size);
+    data = nullptr;
+    return false;
+  }
+  index = data + index_offset;
+  // Check every game once so the accessors need not
+  for (size_t game = 0; game < count; game++) {
+    unsigned long long offset = read_u64(index + 8 * game);
+    if (offset < HEADER_SIZE || offset > index_offset ||
+        read_systems(data + offset, index, nullptr) == nullptr) {
+      munmap(mapped, size);
+      data = nullptr;
+      index = nullptr;
+      count = 0;
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t GameRecordReader::num_games() const {
+  return count;
+}
+
+const unsigned char *GameRecordReader::game_data(size_t game) const {
+  return data + read_u64(index + 8 * game);
+}
+
+int GameRecordReader::winner(size_t game) const {
+  return game_data(game)[3];
+}
+
+int GameRecordReader::label(size_t game) const {
+  return game_data(game)[4];
+}
+
+int GameRecordReader::num_actions(size_t game) const {
+  return read_u32(game_data(game) + 6);
+}
+
+Game *GameRecordReader::initial_game(size_t game) const {
+  const unsigned char *p = game_data(game);
+  Game *g = new Game(p[0]);
+  g->set_homeworlds_built(p[1]);
+  g->set_cur_player(p[2]);
+  read_systems(p, index, g);
+  return g;
+}
+
+const unsigned char *GameRecordReader::actions(size_t game) const {
+  return read_systems(game_data(game), index, nullptr);
+}
+
+unsigned int GameRecordReader::read_u32(const unsigned char *p) {
+  return p[0] | p[1] << 8 | p[2] << 16 | (unsigned int)p[3] << 24;
+}
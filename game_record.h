@@ -0,0 +1,94 @@
+#ifndef GAME_RECORD_H
+#define GAME_RECORD_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "game.h"
+
+// Compact binary game records. All integers are little endian.
+//
+//   header  "HWGR", u32 version, u64 game count, u64 index offset
+//   games   one after another, each:
+//             u8 players, u8 homeworlds built, u8 player to move,
+//             u8 winner (0 for a draw or a tie), u8 label, u8 systems,
+//             u32 actions,
+//             per system: u8 owner, u8 stars, u8 ships, then a byte per star
+//             (size * 4 + colour) and per ship (player << 4 | size * 4 +
+//             colour),
+//             then a u32 per packed action
+//   index   a u64 file offset per game
+//
+// The label is free for the writer; selfplay stores the player number of
+// engine A there. Systems are not named. Actions refer to systems by their
+// index in Game::systems() before the action, so ids need not be stored.
+
+const static unsigned int GAME_RECORD_VERSION = 1;
+
+// Packs action, which must be legal in game, into 27 bits: type (3),
+// player (3), system index (6), ship (4), travel target index (6), target
+// pyramid (4) and the high bit of the type. HOMEWORLD keeps its second star
+// in place of the system index.
+unsigned int pack_action(const Action& action, const Game& game);
+Action unpack_action(unsigned int packed, const Game& game);
+
+class GameRecordWriter {
+  public:
+    GameRecordWriter(std::ostream& os); // os must be seekable
+    void add(const Game& initial, const std::vector<Action>& actions,
+             int winner, int label = 0);
+    void finish(); // writes the index, call once after the last add
+
+  private:
+    std::ostream& os;
+    std::vector<unsigned long long> offsets;
+};
+
+// Memory-mapped reader
+class GameRecordReader {
+  public:
+    GameRecordReader();
+    ~GameRecordReader();
+
+    // False if missing or malformed: a record out of bounds, or with players,
+    // sizes or a winner out of range. Actions are checked by replay.
+    bool open(const std::string& filename);
+    size_t num_games() const;
+    int winner(size_t game) const;
+    int label(size_t game) const;
+    int num_actions(size_t game) const;
+    Game *initial_game(size_t game) const;
+    const unsigned char *actions(size_t game) const; // packed, little endian
+
+    // Calls visit(game, action) before performing each action of a game.
+    // Stops at an illegal action and returns false.
+    template <typename Visit>
+    bool replay(size_t game, Visit visit) const {
+      Game *g = initial_game(game);
+      const unsigned char *packed = actions(game);
+      bool legal = true;
+      for (int i = 0; i < num_actions(game) && legal; i++) {
+        Action action = unpack_action(read_u32(packed + 4 * i), *g);
+        legal = g->validate_action(action);
+        if (legal) {
+          visit((const Game&)*g, (const Action&)action);
+          g->perform_action(action);
+        }
+      }
+      delete g;
+      return legal;
+    }
+
+    static unsigned int read_u32(const unsigned char *p);
+
+  private:
+    const unsigned char *data;
+    size_t size;
+    unsigned long long count;
+    const unsigned char *index;
+
+    const unsigned char *game_data(size_t game) const;
+};
+
+#endif
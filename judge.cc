@@ -1,18 +1,246 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 #include "game.h"
 #include "game_io.h"
+#include "game_parser.h"
+#include "position_history.h"
+
+// Without arguments, reads a game state and a turn and prints the new state,
+// followed by the winner if there is one. An illegal action is reported on
+// stderr with exit status 1.
+//
+// With --batch, reads many games from a file (or stdin) and checks every
+// action with Game::validate_action, on several threads. The input is
+// either game records as written by selfplay, or a sequence of a game state
+// and a turn, each followed by a blank line. One verdict is printed per
+// game, in input order:
+//
+//   <game> ok turns <t> winner <w>       (0 for a draw or a tie)
+//   <game> illegal turn <t> action <k>: <action>
+//   <game> mismatch turns <t> winner <w>   (record disagrees with the replay)
+//   <game> malformed game
+//
+// A game is drawn, and over, once the same position starts a turn for the
+// given number of times (3 by default, 0 to never stop), as in selfplay.
+//
+// Usage: ./judge < game and turn
+//        ./judge --batch [-j threads] [-r repetitions] [file]
+
+struct Unit {
+  const char *begin;
+  const char *end;
+};
+
+static bool starts_with(const char *p, const char *end, const char *prefix) {
+  size_t length = std::strlen(prefix);
+  return (size_t)(end - p) >= length && std::memcmp(p, prefix, length) == 0;
+}
+
+static const char *next_line(const char *p, const char *end) {
+  const char *newline = (const char*)std::memchr(p, '\n', end - p);
+  return newline == nullptr ? end : newline + 1;
+}
+
+// Splits text into game records, each starting with a "game" line
+static std::vector<Unit> split_records(const char *p, const char *end) {
+  std::vector<Unit> units;
+  for (; p < end; p = next_line(p, end)) {
+    if (starts_with(p, end, "game ")) {
+      if (!units.empty()) {
+        units.back().end = p;
+      }
+      units.push_back(Unit{p, end});
+    }
+  }
+  return units;
+}
+
+// Splits text into pairs of blocks (a game state and a turn), blocks being
+// separated by blank lines
+static std::vector<Unit> split_pairs(const char *p, const char *end) {
+  std::vector<Unit> units;
+  int blocks = 0;
+  bool in_block = false;
+  const char *begin = p;
+  for (; p < end; p = next_line(p, end)) {
+    bool blank = *p == '\n';
+    if (in_block && blank && ++blocks % 2 == 0) {
+      units.push_back(Unit{begin, next_line(p, end)});
+    }
+    if (!in_block && !blank && blocks % 2 == 0) {
+      begin = p;
+    }
+    in_block = !blank;
+  }
+  if (in_block && ++blocks % 2 == 0) {
+    units.push_back(Unit{begin, end});
+  }
+  return units;
+}
+
+static std::string judge_unit(const Unit& unit, bool record, int index,
+                              int repetitions) {
+  GameParser parser(unit.begin, unit.end);
+  int number = index, recorded_winner = 0, recorded_turns = 0;
+  if (record) {
+    const char *header_end = next_line(unit.begin, unit.end);
+    std::istringstream header(std::string(unit.begin, header_end));
+    std::string word;
+    int label;
+    header >> word >> number >> word >> label >> word >> recorded_winner >>
+      word >> recorded_turns;
+    parser = GameParser(header_end, unit.end);
+  }
+
+  std::ostringstream verdict;
+  verdict << number << " ";
+  Game *g = parser.read_game();
+  if (g == nullptr) {
+    verdict << "malformed game";
+    return verdict.str();
+  }
+  int turns = 0;
+  bool in_turn = false;
+  bool repeated = false;
+  PositionHistory history;
+  history.push(g->key());
+  for (int k = 1; !parser.done(); k++) {
+    const char *text = parser.position();
+    Action action = Action();
+    action.type = (ActionType)-1;
+    NameRef name = parser.read_action(action);
+    action.player = g->cur_player();
+    bool game_over = !in_turn && (g->winner() != 0 || repeated);
+    if (game_over || !g->validate_action(action)) {
+      verdict << "illegal turn " << turns + 1 << " action " << k << ": " <<
+        std::string(text, std::find(text, unit.end, '\n')) <<
+        (!game_over ? "" : repeated ? " (drawn by repetition)" :
+         " (game over)");
+      delete g;
+      return verdict.str();
+    }
+
+    g->perform_action(action);
+    in_turn = action.type != PASS;
+    if (action.type == DISCOVER || action.type == HOMEWORLD) {
+      parser.add_name(action.system_target, name);
+    } else if (action.type == PASS) {
+      turns++;
+      k = 0;
+      repeated = repetitions > 0 &&
+        history.count(g->key()) + 1 >= repetitions;
+      history.push(g->key());
+    }
+  }
+
+  int winner = std::max(g->winner(), 0); // a tie is recorded as a draw
+  delete g;
+  if (in_turn) {
+    verdict << "illegal turn " << turns + 1 << " unfinished";
+  } else if (record && (turns != recorded_turns || winner != recorded_winner)) {
+    verdict << "mismatch turns " << turns << " winner " << winner;
+  } else {
+    verdict << "ok turns " << turns << " winner " << winner;
+  }
+  return verdict.str();
+}
+
+static int batch(std::istream& is, int num_threads, int repetitions) {
+  auto start = std::chrono::steady_clock::now();
+  std::string text((std::istreambuf_iterator<char>(is)),
+      std::istreambuf_iterator<char>());
+  const char *begin = text.data(), *end = text.data() + text.size();
+  const char *first = begin;
+  while (first < end && std::isspace((unsigned char)*first)) {
+    first++;
+  }
+  bool record = starts_with(first, end, "game ");
+  std::vector<Unit> units =
+    record ? split_records(begin, end) : split_pairs(begin, end);
+
+  std::vector<std::string> verdicts(units.size());
+  std::atomic<size_t> next(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.push_back(std::thread([&]() {
+          for (size_t u = next++; u < units.size(); u = next++) {
+            verdicts[u] = judge_unit(units[u], record, u, repetitions);
+          }
+        }));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  int ok = 0;
+  for (const std::string& verdict : verdicts) {
+    std::cout << verdict << "\n";
+    ok += verdict.find(" ok ") != std::string::npos;
+  }
+  std::cout.flush();
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  std::cerr << "games " << units.size() << " ok " << ok << " failed "
+    << units.size() - ok << " seconds " << elapsed.count() << std::endl;
+  return ok == (int)units.size() ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && std::string(argv[1]) == "--batch") {
+    int num_threads = std::thread::hardware_concurrency();
+    int repetitions = 3;
+    std::string filename;
+    for (int i = 2; i < argc; i++) {
+      std::string arg = argv[i];
+      if (arg == "-j" && i + 1 < argc) {
+        num_threads = std::atoi(argv[++i]);
+      } else if (arg == "-r" && i + 1 < argc) {
+        repetitions = std::atoi(argv[++i]);
+      } else {
+        filename = arg;
+      }
+    }
+    num_threads = std::max(num_threads, 1);
+    if (filename.empty()) {
+      return batch(std::cin, num_threads, repetitions);
+    }
+    std::ifstream in(filename);
+    if (!in) {
+      std::cerr << "could not open " << filename << std::endl;
+      return 1;
+    }
+    return batch(in, num_threads, repetitions);
+  }
 
-int main() {
   std::map<int, std::string> system_names;
   Game *g = read_game(std::cin, system_names);
+  if (g == nullptr) {
+    std::cerr << "malformed game" << std::endl;
+    return 1;
+  }
 
   while (!std::cin.eof()) {
     Action a;
     std::string system_name = read_action(std::cin, a, system_names);
     a.player = g->cur_player();
+    if (!g->validate_action(a)) {
+      std::cerr << "illegal action " << a << std::endl;
+      delete g;
+      return 1;
+    }
     g->perform_action(a);
-    if (a.type == DISCOVER) {
+    if (a.type == DISCOVER || a.type == HOMEWORLD) {
       system_names.emplace(a.system_target, system_name);
     } else if (a.type == PASS) {
       break;
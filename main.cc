@@ -1,33 +1,135 @@
+#include <fstream>
 #include <iostream>
 
+#include "evaluator.h"
 #include "game.h"
+#include "multi_search.h"
 #include "negamax.h"
+#include "nnue.h"
+#include "opening_book.h"
+#include "proof_search.h"
+#include "tablebase.h"
+#include "trace.h"
 #include "game_io.h"
 
-int main() {
+// Usage: ./main [-n network file] [-b opening book] [-e endgame tablebase]
+//               [-p proof search positions] [weight file]
+//
+// The weight file sets the evaluation feature weights (see weights.txt).
+// With -n, two player games are evaluated by an NNUE network instead (see
+// nnue.h; build with ARCH_FLAGS=-mavx2 for the AVX2 path). With -b, setups
+// found in the opening book are played as is. With -e, positions found in
+// the endgame tablebase are scored as won or lost. With -p, a proof-number
+// search for a win within PROOF_TURNS turns runs first, and a proven win is
+// played without searching. Two player searches write their statistics to
+// stderr as one line of JSON (see write_json in negamax.h).
+
+const static int PROOF_TURNS = 3;
+
+int main(int argc, char *argv[]) {
+  Evaluator evaluator;
+  NnueNetwork *network = nullptr;
+  OpeningBook book;
+  Tablebase tablebase;
+  long long proof_nodes = 0;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-n" && i + 1 < argc) {
+      std::ifstream in(argv[++i], std::ios::binary);
+      NnueNetwork *loaded = new NnueNetwork();
+      if (!loaded->load(in)) {
+        std::cerr << "could not load network from " << argv[i] << std::endl;
+        delete loaded;
+        delete network;
+        return 1;
+      }
+      delete network;
+      network = loaded;
+    } else if (arg == "-b" && i + 1 < argc) {
+      if (!book.open(argv[++i])) {
+        std::cerr << "could not read opening book from " << argv[i] << std::endl;
+        delete network;
+        return 1;
+      }
+    } else if (arg == "-p" && i + 1 < argc) {
+      proof_nodes = std::atoll(argv[++i]);
+    } else if (arg == "-e" && i + 1 < argc) {
+      if (!tablebase.open(argv[++i])) {
+        std::cerr << "could not read tablebase from " << argv[i] << std::endl;
+        delete network;
+        return 1;
+      }
+    } else {
+      std::ifstream weights(argv[i]);
+      if (!weights || !evaluator.load(weights)) {
+        std::cerr << "could not load weights from " << argv[i] << std::endl;
+        delete network;
+        return 1;
+      }
+    }
+  }
+
   std::map<int, std::string> system_names;
   Game *g = read_game(std::cin, system_names);
+  if (g == nullptr) {
+    std::cerr << "malformed game" << std::endl;
+    delete network;
+    return 1;
+  }
+  if (network != nullptr && g->num_players() == 2) {
+    g->set_network(network);
+  }
 
   if (g->winner() != 0) {
     print_game(std::cout, *g, system_names);
+    delete g;
+    delete network;
+    return 0;
+  }
+
+  Action setup;
+  if (book.lookup(*g, setup)) {
+    print_turn(std::cout, *g, {setup, Action{g->cur_player(), PASS}},
+        system_names);
+    delete g;
+    delete network;
     return 0;
   }
 
-  Negamax nm(g);
+  if (proof_nodes > 0 && g->num_players() == 2) {
+    ProofSearch proof;
+    if (proof.solve(g, PROOF_TURNS, proof_nodes) == PROVEN) {
+      print_turn(std::cout, *g, proof.line()[0], system_names);
+      delete g;
+      delete network;
+      return 0;
+    }
+  }
+
+  Search *search;
+  Negamax *negamax = nullptr;
+  if (g->num_players() > 2) {
+    search = new MultiSearch(g, BEST_REPLY);
+  } else {
+    search = negamax = new Negamax(g, evaluator);
+    negamax->set_tablebase(&tablebase);
+  }
   std::vector<Action> actions;
   for (int i = 1; i <= 2; i++) {
-    actions = nm.get_actions(i);
+    actions = search->get_actions(i);
   }
-  std::vector<std::string> new_names({"Sirius","AlphaCentauri","Mars","Venus"});
-  auto new_names_it = new_names.begin();
-  for (Action& a : actions) {
-    if (a.type == DISCOVER) {
-      system_names.emplace(a.system_target, *new_names_it);
-    }
-    print_action(std::cout, a, system_names, new_names_it);
-    std::cout << std::endl;
-    g->perform_action(a);
+  print_turn(std::cout, *g, actions, system_names);
+  if (negamax != nullptr) {
+    write_json(std::cerr, negamax->stats());
+    std::cerr << std::endl;
   }
 
+#ifdef TRACE
+  std::ofstream trace("trace.json");
+  trace_dump(trace);
+#endif
+
+  delete search;
   delete g;
+  delete network;
 }
@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "mcts.h"
+
+const static int VIRTUAL_LOSS = 3;
+const static double EXPLORATION = 1.4;
+const static int MAX_PLAYOUT_TURNS = 200;
+
+MctsNode::MctsNode() :
+    action{0, PASS},
+    player(0),
+    visits(0),
+    wins(0),
+    state(UNEXPANDED),
+    children(nullptr),
+    num_children(0) {}
+
+MctsNode::~MctsNode() {
+  delete[] children;
+}
+
+Mcts::Mcts(const Game *game, int threads) :
+    root_game(game),
+    num_threads(threads < 1 ? 1 : threads),
+    root(new MctsNode()),
+    total_playouts(0) {}
+
+Mcts::~Mcts() {
+  delete root;
+}
+
+std::vector<Action> Mcts::get_actions(int playouts) {
+  search(playouts);
+
+  // Follow the most visited line until the turn ends, falling back to the
+  // first legal action (PASS when available) once we leave the tree.
+  std::vector<Action> actions;
+  Game game(*root_game);
+  const MctsNode *node = root;
+  int player = game.cur_player();
+  while (game.winner() == 0 && game.cur_player() == player) {
+    const MctsNode *best = nullptr;
+    if (node != nullptr && node->state.load() == EXPANDED) {
+      for (int i = 0; i < node->num_children; i++) {
+        const MctsNode *child = &node->children[i];
+        if (best == nullptr || child->visits.load() > best->visits.load()) {
+          best = child;
+        }
+      }
+    }
+
+    Action action;
+    if (best != nullptr) {
+      action = best->action;
+    } else {
+      std::vector<Action> legal;
+      game.legal_actions(legal);
+      if (legal.empty()) {
+        break;
+      }
+      action = legal[0];
+    }
+    node = best;
+    actions.push_back(action);
+    game.perform_action(action);
+  }
+
+  return actions;
+}
+
+void Mcts::search(int playouts) {
+  std::atomic<int> remaining(playouts);
+  std::vector<std::thread> threads;
+  unsigned int seed = 0x9e3779b9 * (total_playouts.load() + 1);
+  for (int i = 1; i < num_threads; i++) {
+    threads.push_back(std::thread(&Mcts::worker, this, &remaining, seed + i));
+  }
+  worker(&remaining, seed);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+int Mcts::playouts() const {
+  return total_playouts.load();
+}
+
+const MctsNode *Mcts::tree() const {
+  return root;
+}
+
+void Mcts::worker(std::atomic<int> *remaining, unsigned int seed) {
+  Rng rng(seed);
+  std::vector<MctsNode*> path;
+  while (remaining->fetch_sub(1) > 0) {
+    iterate(rng, path);
+    total_playouts++;
+  }
+}
+
+void Mcts::iterate(Rng& rng, std::vector<MctsNode*>& path) {
+  Game game(*root_game);
+  MctsNode *node = root;
+  path.clear();
+  path.push_back(node);
+  node->visits += VIRTUAL_LOSS;
+
+  while (game.winner() == 0) {
+    int state = node->state.load(std::memory_order_acquire);
+    if (state != EXPANDED) {
+      // Only one thread may expand a node; everyone else who reaches it
+      // meanwhile treats it as a leaf. Nodes are expanded on their second
+      // visit to keep the tree from filling up with one-visit leaves.
+      bool revisited = node == root || node->visits.load() > VIRTUAL_LOSS;
+      if (state == UNEXPANDED && revisited &&
+          node->state.compare_exchange_strong(state, EXPANDING)) {
+        expand(node, game);
+      } else {
+        break;
+      }
+    }
+    if (node->num_children == 0) {
+      break;
+    }
+
+    node = select(node);
+    node->visits += VIRTUAL_LOSS;
+    path.push_back(node);
+    Action action = node->action;
+    game.perform_action(action);
+  }
+
+  int winner = game.winner();
+  if (winner == 0) {
+    winner = random_playout(game, rng, UNIFORM_POLICY, MAX_PLAYOUT_TURNS);
+  }
+
+  for (MctsNode *n : path) {
+    n->wins += winner == n->player ? 2 : (winner <= 0 ? 1 : 0);
+    n->visits += 1 - VIRTUAL_LOSS;
+  }
+}
+
+void Mcts::expand(MctsNode *node, const Game& game) {
+  std::vector<Action> actions;
+  game.legal_actions(actions);
+  MctsNode *children = nullptr;
+  if (!actions.empty()) {
+    children = new MctsNode[actions.size()];
+    for (unsigned int i = 0; i < actions.size(); i++) {
+      children[i].action = actions[i];
+      children[i].player = game.cur_player();
+    }
+  }
+  node->children = children;
+  node->num_children = actions.size();
+  node->state.store(EXPANDED, std::memory_order_release);
+}
+
+MctsNode *Mcts::select(MctsNode *node) {
+  double log_visits = std::log((double)std::max(1, node->visits.load()));
+  MctsNode *best = nullptr;
+  double best_score = -1;
+  for (int i = 0; i < node->num_children; i++) {
+    MctsNode *child = &node->children[i];
+    int visits = child->visits.load(std::memory_order_relaxed);
+    if (visits == 0) {
+      return child;
+    }
+    int wins = child->wins.load(std::memory_order_relaxed);
+    double score = wins / (2.0 * visits) +
+      EXPLORATION * std::sqrt(log_visits / visits);
+    if (score > best_score) {
+      best_score = score;
+      best = child;
+    }
+  }
+  return best;
+}
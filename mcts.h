@@ -0,0 +1,52 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <atomic>
+#include <vector>
+
+#include "game.h"
+#include "playout.h"
+
+// Tree-parallel Monte Carlo tree search. Worker threads share one tree; node
+// statistics are atomics and a thread descending through a node adds a
+// virtual loss so that other threads are steered towards different lines.
+// Edges are single actions, so a turn is a path ending in a PASS.
+
+struct MctsNode {
+  Action action; // action leading to this node
+  int player; // player who performed action
+  std::atomic<int> visits;
+  std::atomic<int> wins; // half points from player's perspective
+  std::atomic<int> state; // UNEXPANDED, EXPANDING or EXPANDED
+  MctsNode *children; // published by the expanding thread
+  int num_children;
+
+  MctsNode();
+  ~MctsNode();
+};
+
+enum MctsNodeState { UNEXPANDED, EXPANDING, EXPANDED };
+
+class Mcts {
+  public:
+    Mcts(const Game *game, int threads = 1);
+    ~Mcts();
+
+    std::vector<Action> get_actions(int playouts);
+    void search(int playouts);
+    int playouts() const;
+    const MctsNode *tree() const; // the root, whose action is unused
+
+  private:
+    const Game *root_game;
+    int num_threads;
+    MctsNode *root;
+    std::atomic<int> total_playouts;
+
+    void worker(std::atomic<int> *remaining, unsigned int seed);
+    void iterate(Rng& rng, std::vector<MctsNode*>& path);
+    void expand(MctsNode *node, const Game& game);
+    MctsNode *select(MctsNode *node);
+};
+
+#endif
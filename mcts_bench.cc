@@ -0,0 +1,52 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "game.h"
+#include "game_io.h"
+#include "mcts.h"
+
+// Reports MCTS playouts per second at 1, 2, 4, ... N threads for the game
+// state given on stdin.
+// Usage: ./mcts_bench [max threads] [playouts per run]
+int main(int argc, char *argv[]) {
+  int max_threads = argc > 1 ? std::atoi(argv[1]) :
+    std::thread::hardware_concurrency();
+  int playouts = argc > 2 ? std::atoi(argv[2]) : 2000;
+  if (max_threads < 1) {
+    max_threads = 1;
+  }
+
+  std::map<int, std::string> system_names;
+  Game *g = read_game(std::cin, system_names);
+  if (g == nullptr) {
+    std::cerr << "malformed game" << std::endl;
+    return 1;
+  }
+
+  double base_rate = 0;
+  for (int threads = 1; ; threads = std::min(threads * 2, max_threads)) {
+    Mcts mcts(g, threads);
+    auto start = std::chrono::steady_clock::now();
+    mcts.search(playouts);
+    std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    double rate = mcts.playouts() / elapsed.count();
+    if (threads == 1) {
+      base_rate = rate;
+    }
+    std::cout << "threads " << threads;
+    std::cout << " playouts " << mcts.playouts();
+    std::cout << " seconds " << elapsed.count();
+    std::cout << " playouts/sec " << rate;
+    std::cout << " speedup " << rate / base_rate << std::endl;
+
+    if (threads == max_threads) {
+      break;
+    }
+  }
+
+  delete g;
+}
@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "game.h"
+#include "game_io.h"
+#include "turn.h"
+
+// Times the game.cc primitives on each position of a suite. Every benchmark
+// picks a batch size that runs for at least MIN_BATCH_NS, runs a few warmup
+// batches, then times batches until it has MAX_BATCHES or has used
+// TIME_BUDGET_NS, and reports the median and 99th percentile time per call.
+//
+// Output lines are "benchmark <name> position <name> median_ns <t>
+// p99_ns <t> batch <calls> batches <n>".
+//
+// Usage: ./microbench [filter] [suite]
+//   filter only runs benchmarks whose name contains it
+//   suite defaults to positions/bench.txt
+
+const static long long MIN_BATCH_NS = 200000;
+const static long long TIME_BUDGET_NS = 500000000;
+const static int WARMUP_BATCHES = 3;
+const static int MIN_BATCHES = 11;
+const static int MAX_BATCHES = 101;
+
+const static char *ACTION_TYPE_NAMES[] = {
+  "pass", "attack", "discover", "travel", "build", "trade", "sacrifice",
+  "catastrophe", "homeworld"
+};
+
+// Results are folded in here so the compiler cannot drop the work
+static volatile long long sink;
+
+static long long now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// setup(calls) prepares a batch outside the timed region and op(i) is the
+// call being measured
+template <typename Setup, typename Op>
+static void measure(const std::string& name, const std::string& position,
+                    Setup setup, Op op) {
+  setup(1);
+  op(0); // so a cold first call does not decide the batch size
+  int calls = 1;
+  while (true) {
+    setup(calls);
+    long long start = now_ns();
+    for (int i = 0; i < calls; i++) {
+      op(i);
+    }
+    if (now_ns() - start >= MIN_BATCH_NS || calls >= (1 << 20)) {
+      break;
+    }
+    calls *= 2;
+  }
+
+  std::vector<double> per_call;
+  long long budget_start = now_ns();
+  for (int batch = 0; batch < WARMUP_BATCHES + MAX_BATCHES; batch++) {
+    setup(calls);
+    long long start = now_ns();
+    for (int i = 0; i < calls; i++) {
+      op(i);
+    }
+    long long elapsed = now_ns() - start;
+    if (batch >= WARMUP_BATCHES) {
+      per_call.push_back((double)elapsed / calls);
+      if ((int)per_call.size() >= MIN_BATCHES &&
+          now_ns() - budget_start >= TIME_BUDGET_NS) {
+        break;
+      }
+    }
+  }
+
+  std::sort(per_call.begin(), per_call.end());
+  double median = per_call[per_call.size() / 2];
+  double p99 = per_call[std::min(per_call.size() - 1,
+      (size_t)(per_call.size() * 0.99))];
+  std::cout << "benchmark " << name << " position " << position
+    << " median_ns " << (long long)median << " p99_ns " << (long long)p99
+    << " batch " << calls << " batches " << per_call.size() << std::endl;
+}
+
+static void nothing(int) {}
+
+static void run_position(const Game& game, const std::string& position,
+                         const std::string& filter) {
+  auto wanted = [&filter](const std::string& name) {
+    return name.find(filter) != std::string::npos;
+  };
+
+  if (wanted("copy")) {
+    measure("copy", position, nothing, [&game](int) {
+          Game copy(game);
+          sink += copy.cur_player();
+        });
+  }
+  if (wanted("hash")) {
+    measure("hash", position, nothing, [&game](int) { sink += game.hash(); });
+  }
+  if (wanted("winner")) {
+    measure("winner", position, nothing,
+        [&game](int) { sink += game.winner(); });
+  }
+  if (wanted("legal_actions")) {
+    std::vector<Action> actions;
+    measure("legal_actions", position, nothing, [&game, &actions](int) {
+          actions.clear();
+          game.legal_actions(actions);
+          sink += actions.size();
+        });
+  }
+
+  // legal_actions makes HOMEWORLDs itself, since they have no system yet
+  for (int type = ATTACK; type <= HOMEWORLD; type++) {
+    std::string name = std::string("legal_system_actions/") +
+      ACTION_TYPE_NAMES[type];
+    if (!wanted(name) || type == HOMEWORLD) {
+      continue;
+    }
+    std::vector<Action> actions;
+    measure(name, position, nothing, [&game, &actions, type](int) {
+          actions.clear();
+          for (const System& system : game.systems()) {
+            game.legal_system_actions(actions, system, (ActionType)type);
+          }
+          sink += actions.size();
+        });
+  }
+
+  std::vector<Action> legal;
+  game.legal_actions(legal);
+  for (int type = PASS; type <= HOMEWORLD; type++) {
+    std::string name = std::string("perform_action/") + ACTION_TYPE_NAMES[type];
+    auto it = std::find_if(legal.begin(), legal.end(),
+        [type](const Action& action) { return action.type == type; });
+    if (!wanted(name) || it == legal.end()) {
+      continue;
+    }
+    Action action = *it;
+    std::vector<Game> games;
+    measure(name, position, [&game, &games](int calls) {
+          games.assign(calls, game);
+        }, [&games, action](int i) {
+          Action a = action;
+          sink += games[i].perform_action(a);
+        });
+  }
+
+  if (wanted("connected")) {
+    const std::vector<System>& systems = game.systems();
+    measure("connected", position, nothing, [&systems](int) {
+          int count = 0;
+          for (const System& a : systems) {
+            for (const System& b : systems) {
+              count += connected(a, b);
+            }
+          }
+          sink += count;
+        });
+  }
+  if (wanted("get_turns")) {
+    measure("get_turns", position, nothing, [&game](int) {
+          std::vector<Turn*> turns = get_turns(&game);
+          sink += turns.size();
+          for (Turn *turn : turns) {
+            delete turn;
+          }
+        });
+  }
+}
+
+int main(int argc, char *argv[]) {
+  std::string filter = argc > 1 ? argv[1] : "";
+  const char *filename = argc > 2 ? argv[2] : "positions/bench.txt";
+  std::ifstream in(filename);
+  if (!in) {
+    std::cerr << "could not open " << filename << std::endl;
+    return 1;
+  }
+
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream ls(line);
+    std::string word, name;
+    if (!(ls >> word >> name) || word != "bench") {
+      continue;
+    }
+    std::map<int, std::string> system_names;
+    Game *game = read_game(in, system_names);
+    if (game == nullptr) {
+      std::cerr << "skipping malformed position " << name << std::endl;
+      continue;
+    }
+    run_position(*game, name, filter);
+    delete game;
+  }
+}
@@ -0,0 +1,175 @@
+#include <algorithm>
+
+#include "multi_search.h"
+
+MultiSearch::MultiSearch(const Game *game, MultiSearchMode mode) :
+    root_game(game), mode(mode), root_player(game->cur_player()) {}
+
+std::vector<Action> MultiSearch::get_actions(int depth) {
+  if (depth == 0 || root_game->winner() != 0) {
+    return std::vector<Action>({Action{PASS}});
+  }
+
+  root_player = root_game->cur_player();
+  int best = -1;
+  const Turn *best_turn = nullptr;
+  std::vector<Turn*> turns = get_turns(root_game);
+  for (const Turn *turn : turns) {
+    int value;
+    if (mode == PARANOID) {
+      value = paranoid(turn->game, depth - 1, best, MAX_SCORE + 1);
+    } else if (mode == BEST_REPLY) {
+      value = best_reply(turn->game, depth - 1, best, MAX_SCORE + 1);
+    } else {
+      value = maxn(turn->game, depth - 1, std::max(best, 0))[root_player];
+    }
+    if (value > best) {
+      best = value;
+      best_turn = turn;
+    }
+  }
+
+  std::vector<Action> actions({Action{PASS}});
+  if (best_turn != nullptr) {
+    actions.assign(best_turn->actions.begin(), best_turn->actions.end());
+  }
+  for (Turn *turn : turns) {
+    delete turn;
+  }
+  return actions;
+}
+
+int MultiSearch::paranoid(const Game *game, int depth, int a, int b) {
+  if (depth == 0 || game->winner() != 0) {
+    return evaluate(game)[root_player];
+  }
+
+  std::vector<Turn*> turns = get_turns(game);
+  if (turns.empty()) {
+    return evaluate(game)[root_player];
+  }
+
+  bool maximizing = game->cur_player() == root_player;
+  int best = maximizing ? -1 : MAX_SCORE + 1;
+  for (const Turn *turn : turns) {
+    int value = paranoid(turn->game, depth - 1, a, b);
+    if (maximizing) {
+      best = std::max(best, value);
+      a = std::max(a, best);
+    } else {
+      best = std::min(best, value);
+      b = std::min(b, best);
+    }
+    if (a >= b) {
+      break;
+    }
+  }
+  for (Turn *turn : turns) {
+    delete turn;
+  }
+
+  return best;
+}
+
+int MultiSearch::best_reply(const Game *game, int depth, int a, int b) {
+  if (depth == 0 || game->winner() != 0) {
+    return evaluate(game)[root_player];
+  }
+
+  if (game->cur_player() == root_player) {
+    std::vector<Turn*> turns = get_turns(game);
+    int best = turns.empty() ? evaluate(game)[root_player] : -1;
+    for (Turn *turn : turns) {
+      best = std::max(best, best_reply(turn->game, depth - 1, a, b));
+      a = std::max(a, best);
+      if (a >= b) {
+        break;
+      }
+    }
+    for (Turn *turn : turns) {
+      delete turn;
+    }
+    return best;
+  }
+
+  // The opponents form a single minimizing layer: every opponent's turns are
+  // tried from this position and play then returns to the root player.
+  int best = MAX_SCORE + 1;
+  for (int opponent = 1; opponent <= game->num_players() && a < b; opponent++) {
+    if (opponent == root_player || game->eliminated(opponent)) {
+      continue;
+    }
+    Game g(*game);
+    g.set_cur_player(opponent);
+    std::vector<Turn*> turns = get_turns(&g);
+    for (Turn *turn : turns) {
+      turn->game->set_cur_player(root_player);
+      best = std::min(best, best_reply(turn->game, depth - 1, a, b));
+      b = std::min(b, best);
+      if (a >= b) {
+        break;
+      }
+    }
+    for (Turn *turn : turns) {
+      delete turn;
+    }
+  }
+  return best == MAX_SCORE + 1 ? evaluate(game)[root_player] : best;
+}
+
+Scores MultiSearch::maxn(const Game *game, int depth, int bound) {
+  if (depth == 0 || game->winner() != 0) {
+    return evaluate(game);
+  }
+
+  std::vector<Turn*> turns = get_turns(game);
+  if (turns.empty()) {
+    return evaluate(game);
+  }
+
+  int player = game->cur_player();
+  Scores best;
+  best.fill(0);
+  best[player] = -1;
+  for (const Turn *turn : turns) {
+    Scores value = maxn(turn->game, depth - 1, std::max(best[player], 0));
+    if (value[player] > best[player]) {
+      best = value;
+    }
+    // Shallow pruning: the parent's player gets at most MAX_SCORE minus our
+    // score here, which can no longer beat what it already has.
+    if (best[player] >= MAX_SCORE - bound) {
+      break;
+    }
+  }
+  for (Turn *turn : turns) {
+    delete turn;
+  }
+
+  return best;
+}
+
+Scores MultiSearch::evaluate(const Game *game) {
+  Scores scores;
+  scores.fill(0);
+
+  int winner = game->winner();
+  if (winner > 0) {
+    scores[winner] = MAX_SCORE;
+    return scores;
+  } else if (winner == -1) {
+    return scores;
+  }
+
+  int total = 0;
+  for (int player = 1; player <= game->num_players(); player++) {
+    if (!game->eliminated(player)) {
+      scores[player] = game->material(player);
+    }
+    total += scores[player];
+  }
+  for (int player = 1; total > 0 && player <= game->num_players(); player++) {
+    scores[player] = scores[player] * MAX_SCORE / total;
+  }
+  return scores;
+}
@@ -0,0 +1,39 @@
+#ifndef MULTI_SEARCH_H
+#define MULTI_SEARCH_H
+
+#include <array>
+#include <vector>
+
+#include "game.h"
+#include "search.h"
+#include "turn.h"
+
+// Per-player evaluation, indexed by player. Values are non-negative and sum
+// to at most MAX_SCORE, which is what makes shallow pruning in max^n sound.
+typedef std::array<int, MAX_PLAYERS + 1> Scores;
+
+const static int MAX_SCORE = 1000;
+
+enum MultiSearchMode {
+  PARANOID, // all opponents minimize the root player's score
+  BEST_REPLY, // only the strongest opponent reply is searched at each layer
+  MAXN // every player maximizes their own score
+};
+
+class MultiSearch : public Search {
+  public:
+    MultiSearch(const Game *game, MultiSearchMode mode);
+
+    std::vector<Action> get_actions(int depth) override;
+    int paranoid(const Game *game, int depth, int a, int b);
+    int best_reply(const Game *game, int depth, int a, int b);
+    Scores maxn(const Game *game, int depth, int bound);
+    Scores evaluate(const Game *game);
+
+  private:
+    const Game *root_game;
+    MultiSearchMode mode;
+    int root_player;
+};
+
+#endif
@@ -1,34 +1,94 @@
 #include <algorithm>
 
+#include <sys/resource.h>
+
 #include "negamax.h"
 #include "game_io.h"
+#include "nnue.h"
+#include "trace.h"
+
+Negamax::Negamax(const Game *game, const Evaluator& evaluator) :
+    root_game(game), evaluator(evaluator), tablebase(nullptr), search_stats(),
+    stop_flag(false), deadline(Deadline::max()), root_value(0),
+    root_depth(0) {}
+
+void Negamax::set_root(const Game *game) {
+  root_game = game;
+}
+
+void Negamax::set_evaluator(const Evaluator& evaluator) {
+  this->evaluator = evaluator;
+  eval_cache.clear();
+}
+
+void Negamax::set_tablebase(const Tablebase *tablebase) {
+  this->tablebase = tablebase;
+}
+
+void Negamax::set_history(const PositionHistory& history) {
+  this->history = history;
+}
+
+void Negamax::clear() {
+  transpositions.clear();
+  eval_cache.clear();
+}
+
+void Negamax::set_deadline(Deadline deadline) {
+  this->deadline = deadline;
+}
 
-Turn::~Turn() {
-  delete game;
+void Negamax::stop() {
+  stop_flag = true;
 }
 
-Negamax::Negamax(const Game *game) : root_game(game) {}
+void Negamax::resume() {
+  stop_flag = false;
+  deadline = Deadline::max();
+}
+
+bool Negamax::stopped() const {
+  return stop_flag;
+}
+
+int Negamax::value() const {
+  return root_value;
+}
 
 std::vector<Action> Negamax::get_actions(int depth) {
   if (depth == 0 || root_game->winner() != 0) {
     return std::vector<Action>({Action{PASS}});
   }
 
+  auto start = std::chrono::steady_clock::now();
+  root_depth = depth;
   int best = -10000000;
-  const Turn *best_turn;
   std::vector<Turn*> turns = get_turns(root_game);
-  std::sort(turns.begin(), turns.end(),
-      [this](const Turn *a, const Turn *b) {
-        int ha = a->game->hash();
-        int hb = b->game->hash();
-        int sa = this->transpositions.count(ha) > 0 ? this->transpositions[ha].value : 0;
-        int sb = this->transpositions.count(hb) > 0 ? this->transpositions[hb].value : 0;
-        return sa < sb;
-      });
+  if (turns.empty()) {
+    return std::vector<Action>({Action{PASS}});
+  }
+  const Turn *best_turn = turns[0];
+  {
+    TRACE_SCOPE("sort");
+    std::sort(turns.begin(), turns.end(),
+        [this](const Turn *a, const Turn *b) {
+          int ha = a->game->hash();
+          int hb = b->game->hash();
+          int sa = this->transpositions.count(ha) > 0 ? this->transpositions[ha].value : 0;
+          int sb = this->transpositions.count(hb) > 0 ? this->transpositions[hb].value : 0;
+          return sa < sb;
+        });
+  }
   int a = -10000000;
   int b = 10000000;
+  int num = 0;
+  history.push(root_game->key());
   for (const Turn *turn : turns) {
     int value = -negamax(turn->game, depth - 1, -b, -a);
+    if (stop_flag) {
+      break;
+    }
+    num++;
     if (value > best) {
       best = value;
       best_turn = turn;
@@ -46,6 +106,20 @@ std::vector<Action> Negamax::get_actions(int depth) {
     }
   }
 
+  history.pop();
+  count_turns(depth, turns.size(), num, a >= b);
+  if (!stop_flag) { // a stopped iteration keeps the last complete one's
+    root_value = best;
+    search_stats.depth = depth;
+  }
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  search_stats.seconds += elapsed.count();
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    search_stats.peak_rss_kb = usage.ru_maxrss;
+  }
+
   std::vector<Action> actions(best_turn->actions.begin(), best_turn->actions.end());
   for (Turn *turn : turns) {
     delete turn;
@@ -54,13 +128,39 @@ std::vector<Action> Negamax::get_actions(int depth) {
 }
 
 int Negamax::negamax(const Game *game, int depth, int a, int b) {
+  TRACE_SCOPE_ARG("negamax", "depth", depth);
   int olda = a;
+  long long repetitions = search_stats.repetitions;
+  search_stats.nodes++;
+  if (!stop_flag && deadline != Deadline::max() &&
+      std::chrono::steady_clock::now() >= deadline) {
+    stop_flag = true;
+  }
+  if (stop_flag) {
+    return 0;
+  }
+
+  // Either side can steer back into a cycle, so neither can do better than
+  // a draw by entering one
+  if (history.count(game->key()) > 0) {
+    search_stats.repetitions++;
+    return 0;
+  }
+
+  int distance;
+  if (tablebase != nullptr && tablebase->probe(*game, distance)) {
+    search_stats.tablebase_hits++;
+    return distance > 0 ? 1000000 - distance : -1000000 - distance;
+  }
 
   int h = game->hash();
+  search_stats.tt_probes++;
   if (transpositions.count(h) > 0) {
+    search_stats.tt_hits++;
     Transposition t = transpositions[h];
     if (t.depth >= depth) {
       if (t.flag == EXACT) {
+        search_stats.tt_cutoffs++;
         return t.value;
       } else if (t.flag == LOWERBOUND) {
         a = std::max(a, t.value);
@@ -68,6 +168,7 @@ int Negamax::negamax(const Game *game, int depth, int a, int b) {
         a = std::min(b, t.value);
       }
       if (a >= b) {
+        search_stats.tt_cutoffs++;
         return t.value;
       }
     }
@@ -79,15 +180,19 @@ int Negamax::negamax(const Game *game, int depth, int a, int b) {
 
   int best = -10000000;
   std::vector<Turn*> turns = get_turns(game);
-  std::sort(turns.begin(), turns.end(),
-      [this](const Turn *a, const Turn *b) {
-        int ha = a->game->hash();
-        int hb = b->game->hash();
-        int sa = this->transpositions.count(ha) > 0 ? this->transpositions[ha].value : 0;
-        int sb = this->transpositions.count(hb) > 0 ? this->transpositions[hb].value : 0;
-        return sa > sb;
-      });
+  {
+    TRACE_SCOPE("sort");
+    std::sort(turns.begin(), turns.end(),
+        [this](const Turn *a, const Turn *b) {
+          int ha = a->game->hash();
+          int hb = b->game->hash();
+          int sa = this->transpositions.count(ha) > 0 ? this->transpositions[ha].value : 0;
+          int sb = this->transpositions.count(hb) > 0 ? this->transpositions[hb].value : 0;
+          return sa > sb;
+        });
+  }
   int num = 0;
+  history.push(game->key());
   for (const Turn *turn : turns) {
     int value = -negamax(turn->game, depth - 1, -b, -a);
     best = std::max(best, value);
@@ -97,9 +202,17 @@ int Negamax::negamax(const Game *game, int depth, int a, int b) {
       break;
     }
   }
+  history.pop();
+  count_turns(depth, turns.size(), num, a >= b);
   for (Turn *turn : turns) {
     delete turn;
   }
+  if (stop_flag) {
+    return 0; // incomplete, so not worth a transposition
+  }
+  if (search_stats.repetitions > repetitions) {
+    return best; // depends on the path here, which the table does not key
+  }
 
   Transposition t{best, depth};
   if (best <= olda) {
@@ -115,60 +228,91 @@ int Negamax::negamax(const Game *game, int depth, int a, int b) {
 }
 
 int Negamax::heuristic(const Game *game) {
+  TRACE_SCOPE("heuristic");
+  search_stats.evals++;
+  search_stats.eval_cache_probes++;
+  unsigned long long key = game->key();
+  int value;
+  if (eval_cache.probe(key, value)) {
+    search_stats.eval_cache_hits++;
+    return value;
+  }
+
   // Negamax only works for two players
-  return half_heuristic(game, game->cur_player()) -
-      half_heuristic(game, 3 - game->cur_player());
+  int winner = game->winner();
+  if (winner == 0 && game->network() != nullptr) {
+    value = nnue_evaluate(game);
+  } else {
+    value = half_heuristic(game, game->cur_player(), winner) -
+      half_heuristic(game, 3 - game->cur_player(), winner);
+  }
+  eval_cache.store(key, value);
+  return value;
 }
 
-int Negamax::half_heuristic(const Game *game, int player) {
-  if (game->winner() == player) {
+int Negamax::half_heuristic(const Game *game, int player, int winner) {
+  if (winner == player) {
     return 1000000;
-  } else if (game->winner() != 0) {
+  } else if (winner != 0) {
     return 0;
   }
 
-  int total = 0;
-  for (const System& system : game->systems()) {
-    for (const Ship& ship : system.ships) {
-      if (ship.player == player) {
-        total += 100 * ship.pyramid.size * ship.pyramid.size;
-      }
-    }
-  }
-
-  return total;
+  return evaluator.evaluate(game, player);
 }
 
+void Negamax::count_turns(int depth, int generated, int searched,
+                          bool cutoff) {
+  int ply = std::min(root_depth - depth, STATS_PLIES - 1);
+  search_stats.expanded[ply]++;
+  search_stats.turns_generated[ply] += generated;
+  search_stats.turns_searched[ply] += searched;
+  if (cutoff && searched > 0) {
+    search_stats.beta_cutoffs[std::min(searched, STATS_CUTOFF_INDICES) - 1]++;
+  }
+}
 
-std::vector<Turn*> Negamax::get_turns(const Game *game) {
-  std::unordered_map<int, Turn*> result;
-  std::vector<Action> actions;
-  game->legal_actions(actions);
+const SearchStats& Negamax::stats() const {
+  return search_stats;
+}
 
-  for (Action& action : actions) {
-    if (action.type == PASS) {
-      Game *g = new Game(*game);
-      g->perform_action(action);
-      result.emplace(g->hash(), new Turn{g, std::deque<Action>({action})});
-      continue;
-    }
+void Negamax::reset_stats() {
+  search_stats = SearchStats();
+}
 
-    Game *g = new Game(*game);
-    g->perform_action(action);
-    for (Turn *turn : get_turns(g)) {
-      if (result.count(turn->game->hash()) == 0) {
-        turn->actions.push_front(action);
-        result.emplace(turn->game->hash(), turn);
-      } else {
-        delete turn;
-      }
+void write_json(std::ostream& os, const SearchStats& stats) {
+  long long generated = 0;
+  long long searched = 0;
+  int plies = 0;
+  for (int ply = 0; ply < STATS_PLIES; ply++) {
+    generated += stats.turns_generated[ply];
+    searched += stats.turns_searched[ply];
+    if (stats.expanded[ply] > 0) {
+      plies = ply + 1;
     }
-    delete g;
   }
 
-  std::vector<Turn*> real_result;
-  for (const auto& p : result) {
-    real_result.push_back(p.second);
+  os << "{\"depth\":" << stats.depth;
+  os << ",\"ms\":" << (long long)(stats.seconds * 1000);
+  os << ",\"nodes\":" << stats.nodes;
+  os << ",\"evals\":" << stats.evals;
+  os << ",\"eval_cache_probes\":" << stats.eval_cache_probes;
+  os << ",\"eval_cache_hits\":" << stats.eval_cache_hits;
+  os << ",\"tt_probes\":" << stats.tt_probes;
+  os << ",\"tt_hits\":" << stats.tt_hits;
+  os << ",\"tt_cutoffs\":" << stats.tt_cutoffs;
+  os << ",\"tablebase_hits\":" << stats.tablebase_hits;
+  os << ",\"repetitions\":" << stats.repetitions;
+  os << ",\"beta_cutoffs\":[";
+  for (int i = 0; i < STATS_CUTOFF_INDICES; i++) {
+    os << (i > 0 ? "," : "") << stats.beta_cutoffs[i];
+  }
+  os << "],\"branching\":[";
+  for (int ply = 0; ply < plies; ply++) {
+    os << (ply > 0 ? "," : "");
+    os << (stats.expanded[ply] > 0 ?
+        (double)stats.turns_generated[ply] / stats.expanded[ply] : 0);
   }
-  return real_result;
+  os << "],\"turns_generated\":" << generated;
+  os << ",\"turns_searched\":" << searched;
+  os << ",\"peak_rss_kb\":" << stats.peak_rss_kb << "}";
 }
@@ -1,19 +1,20 @@
 #ifndef NEGAMAX_H
 #define NEGAMAX_H
 
-#include <deque>
+#include <atomic>
+#include <chrono>
+#include <iostream>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "eval_cache.h"
+#include "evaluator.h"
 #include "game.h"
-
-struct Turn {
-  Game *game;
-  std::deque<Action> actions;
-
-  ~Turn();
-};
+#include "position_history.h"
+#include "search.h"
+#include "tablebase.h"
+#include "turn.h"
 
 enum TranspositionFlag { EXACT, LOWERBOUND, UPPERBOUND };
 
@@ -23,20 +24,85 @@ struct Transposition {
   TranspositionFlag flag;
 };
 
-class Negamax {
+const static int STATS_PLIES = 16; // deeper plies are counted in the last
+const static int STATS_CUTOFF_INDICES = 8; // later moves are counted in the last
+
+// Counters for the searches since the last reset_stats
+struct SearchStats {
+  int depth; // of the last completed get_actions
+  double seconds; // spent in get_actions
+  long long nodes;
+  long long evals;
+  long long eval_cache_probes;
+  long long eval_cache_hits;
+  long long tt_probes;
+  long long tt_hits;
+  long long tt_cutoffs; // nodes answered from the transposition table
+  long long tablebase_hits; // nodes answered from the endgame tablebase
+  long long repetitions; // nodes scored as draws by repetition
+  long long beta_cutoffs[STATS_CUTOFF_INDICES]; // by index of the cutting move
+  long long expanded[STATS_PLIES]; // nodes whose turns were generated, by ply
+  long long turns_generated[STATS_PLIES];
+  long long turns_searched[STATS_PLIES];
+  long peak_rss_kb; // of the whole process
+};
+
+// Writes stats as one line of JSON, without a newline
+void write_json(std::ostream& os, const SearchStats& stats);
+
+typedef std::chrono::steady_clock::time_point Deadline;
+
+class Negamax : public Search {
   public:
-    Negamax(const Game *game);
+    Negamax(const Game *game, const Evaluator& evaluator = Evaluator());
+
+    // Searches from game from now on, keeping transpositions
+    void set_root(const Game *game);
+    void set_evaluator(const Evaluator& evaluator);
+    // Positions the table has a result for are scored as won or lost
+    // instead of searched (nullptr to stop probing)
+    void set_tablebase(const Tablebase *tablebase);
+    // Keys of the positions at the start of the turns played before the
+    // root. A position that repeats one of them, or one earlier on the
+    // search path, is scored as a draw. Nodes whose subtree met a repetition
+    // are not kept as transpositions.
+    void set_history(const PositionHistory& history);
+    // Forgets transpositions and cached evaluations
+    void clear();
+
+    // A stopped search abandons the tree and get_actions returns the best
+    // turn found so far. Stopping is safe from other threads; the search also
+    // stops itself once the deadline has passed.
+    void set_deadline(Deadline deadline);
+    void stop();
+    void resume(); // clears the stop flag and the deadline
+    bool stopped() const;
+    int value() const; // root value of the last completed get_actions
 
-    std::vector<Action> get_actions(int depth);
+    std::vector<Action> get_actions(int depth) override;
     int negamax(const Game *game, int depth, int a, int b);
     int heuristic(const Game *game);
-    int half_heuristic(const Game *game, int player);
+    int half_heuristic(const Game *game, int player, int winner);
+
+    const SearchStats& stats() const;
+    void reset_stats();
 
   private:
     const Game *root_game;
+    Evaluator evaluator;
+    const Tablebase *tablebase;
+    PositionHistory history; // before the root, then the search path
+    EvalCache eval_cache;
+    SearchStats search_stats;
+    std::atomic<bool> stop_flag;
+    Deadline deadline;
+    int root_value;
+
+    int root_depth;
 
-    std::vector<Turn*> get_turns(const Game *game);
     std::unordered_map<int, Transposition> transpositions;
+
+    void count_turns(int depth, int generated, int searched, bool cutoff);
 };
 
 #endif
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cstring>
+
+#ifdef __AVX2__
+  #include <immintrin.h>
+#endif
+
+#include "game.h"
+#include "nnue.h"
+
+// Quantization: accumulator values are clipped to [0, 127] before the dense
+// layer, dense layer sums are shifted down by LAYER_SHIFT and clipped to
+// [0, 127] again, and the output sum is shifted down by OUTPUT_SHIFT.
+const static int LAYER_SHIFT = 6;
+const static int OUTPUT_SHIFT = 4;
+
+bool NnueNetwork::load(std::istream& is) {
+  char magic[4];
+  is.read(magic, 4);
+  if (!is || std::memcmp(magic, "HWNN", 4) != 0) {
+    return false;
+  }
+  is.read((char*)input_weights, sizeof(input_weights));
+  is.read((char*)input_bias, sizeof(input_bias));
+  is.read((char*)layer_weights, sizeof(layer_weights));
+  is.read((char*)layer_bias, sizeof(layer_bias));
+  is.read((char*)output_weights, sizeof(output_weights));
+  is.read((char*)&output_bias, sizeof(output_bias));
+  widen();
+  return (bool)is;
+}
+
+void NnueNetwork::save(std::ostream& os) const {
+  os.write("HWNN", 4);
+  os.write((const char*)input_weights, sizeof(input_weights));
+  os.write((const char*)input_bias, sizeof(input_bias));
+  os.write((const char*)layer_weights, sizeof(layer_weights));
+  os.write((const char*)layer_bias, sizeof(layer_bias));
+  os.write((const char*)output_weights, sizeof(output_weights));
+  os.write((const char*)&output_bias, sizeof(output_bias));
+}
+
+void NnueNetwork::widen() {
+  for (int o = 0; o < NNUE_LAYER; o++) {
+    for (int i = 0; i < 2 * NNUE_HIDDEN; i++) {
+      layer_weights16[o][i] = layer_weights[o][i];
+    }
+  }
+}
+
+int nnue_ship_feature(int pyramid_size, int pyramid_colour, bool own,
+                      SystemRole role) {
+  int pyramid = (pyramid_size - 1) * 4 + pyramid_colour;
+  return (role * 2 + (own ? 0 : 1)) * 12 + pyramid;
+}
+
+int nnue_star_feature(int pyramid_size, int pyramid_colour, SystemRole role) {
+  int pyramid = (pyramid_size - 1) * 4 + pyramid_colour;
+  return 12 * 2 * 3 + role * 12 + pyramid;
+}
+
+// Clipped ReLU of both accumulators, mover first
+static void clip_inputs(const NnueAccumulator& accumulator, int player,
+                        short *inputs) {
+  const short *halves[2] = {
+    accumulator.values[player - 1], accumulator.values[2 - player]
+  };
+#ifdef __AVX2__
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i max = _mm256_set1_epi16(127);
+  for (int half = 0; half < 2; half++) {
+    for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+      __m256i v = _mm256_loadu_si256((const __m256i*)(halves[half] + i));
+      v = _mm256_min_epi16(_mm256_max_epi16(v, zero), max);
+      _mm256_storeu_si256((__m256i*)(inputs + half * NNUE_HIDDEN + i), v);
+    }
+  }
+#else
+  for (int half = 0; half < 2; half++) {
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+      inputs[half * NNUE_HIDDEN + i] =
+        std::min<short>(std::max<short>(halves[half][i], 0), 127);
+    }
+  }
+#endif
+}
+
+static int dot(const short *a, const short *b) {
+#ifdef __AVX2__
+  __m256i sum = _mm256_setzero_si256();
+  for (int i = 0; i < 2 * NNUE_HIDDEN; i += 16) {
+    __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+    __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(va, vb));
+  }
+  __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum),
+      _mm256_extracti128_si256(sum, 1));
+  half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4e));
+  half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xb1));
+  return _mm_cvtsi128_si32(half);
+#else
+  int sum = 0;
+  for (int i = 0; i < 2 * NNUE_HIDDEN; i++) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+#endif
+}
+
+int nnue_evaluate(const Game *game) {
+  const NnueNetwork& network = *game->network();
+  short inputs[2 * NNUE_HIDDEN];
+  clip_inputs(game->accumulator(), game->cur_player(), inputs);
+
+  int output = network.output_bias;
+  for (int o = 0; o < NNUE_LAYER; o++) {
+    int sum = network.layer_bias[o] + dot(inputs, network.layer_weights16[o]);
+    int hidden = std::min(std::max(sum >> LAYER_SHIFT, 0), 127);
+    output += hidden * network.output_weights[o];
+  }
+  return output >> OUTPUT_SHIFT;
+}
@@ -0,0 +1,53 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <iostream>
+
+// Optional neural network evaluation for two player games.
+//
+// Inputs are sparse features relative to a perspective: every ship is a
+// (pyramid, own or enemy, system role) feature and every star a (pyramid,
+// system role) feature, where the role is our homeworld, the enemy homeworld
+// or neither. Game keeps one accumulator of input layer sums per perspective
+// up to date as ships and stars come and go, so an evaluation only runs the
+// small quantized dense head on top of the two accumulators.
+
+class Game;
+
+enum SystemRole { OWN_HOME = 0, ENEMY_HOME, COLONY };
+
+const static int NNUE_INPUTS = 12 * 2 * 3 + 12 * 3;
+const static int NNUE_HIDDEN = 32; // accumulator size per perspective
+const static int NNUE_LAYER = 16; // dense layer size
+
+struct NnueAccumulator {
+  short values[2][NNUE_HIDDEN]; // players 1 and 2
+};
+
+// File layout (little endian): "HWNN", then the int16 input weights and
+// biases, the int8 dense layer weights and int32 biases, and the int8 output
+// weights and int32 output bias, in the order of the fields below.
+struct NnueNetwork {
+  short input_weights[NNUE_INPUTS][NNUE_HIDDEN];
+  short input_bias[NNUE_HIDDEN];
+  signed char layer_weights[NNUE_LAYER][2 * NNUE_HIDDEN];
+  int layer_bias[NNUE_LAYER];
+  signed char output_weights[NNUE_LAYER];
+  int output_bias;
+
+  // layer_weights widened for multiply-add, filled in by load
+  short layer_weights16[NNUE_LAYER][2 * NNUE_HIDDEN];
+
+  bool load(std::istream& is);
+  void save(std::ostream& os) const;
+  void widen(); // refreshes layer_weights16 after layer_weights change
+};
+
+int nnue_ship_feature(int pyramid_size, int pyramid_colour, bool own,
+                      SystemRole role);
+int nnue_star_feature(int pyramid_size, int pyramid_colour, SystemRole role);
+
+// Evaluation from the perspective of the player to move
+int nnue_evaluate(const Game *game);
+
+#endif
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "opening_book.h"
+
+const static int HEADER_SIZE = 12;
+const static int ENTRY_SIZE = 44;
+
+static void write_u32(std::ostream& os, unsigned int value) {
+  for (int i = 0; i < 4; i++) {
+    os.put((char)(value >> (8 * i)));
+  }
+}
+
+static unsigned long long read_bytes(const unsigned char *p, int n) {
+  unsigned long long value = 0;
+  for (int i = n - 1; i >= 0; i--) {
+    value = value << 8 | p[i];
+  }
+  return value;
+}
+
+static unsigned char pack_pyramid(const Pyramid& pyramid) {
+  return pyramid.size * 4 + pyramid.colour;
+}
+
+static Pyramid unpack_pyramid(unsigned char bits) {
+  return Pyramid{(Size)((bits >> 2) & 3), (Colour)(bits & 3)};
+}
+
+double BookEntry::score() const {
+  return games == 0 ? 0 : points / (2.0 * games);
+}
+
+void write_book(std::ostream& os, std::vector<BookEntry> entries) {
+  std::sort(entries.begin(), entries.end(),
+      [](const BookEntry& a, const BookEntry& b) {
+        return a.key < b.key || (a.key == b.key && a.score() > b.score());
+      });
+  os.write("HWOB", 4);
+  write_u32(os, OPENING_BOOK_VERSION);
+  write_u32(os, entries.size());
+  for (const BookEntry& entry : entries) {
+    for (int i = 0; i < 4; i++) {
+      write_u32(os, entry.key.words[i]);
+      write_u32(os, entry.key.words[i] >> 32);
+    }
+    os.put(pack_pyramid(entry.setup.target));
+    os.put(pack_pyramid(entry.setup.star));
+    os.put(pack_pyramid(entry.setup.ship));
+    os.put(0);
+    write_u32(os, entry.games);
+    write_u32(os, entry.points);
+  }
+  os.flush();
+}
+
+OpeningBook::OpeningBook() : data(nullptr), bytes(0), count(0) {}
+
+OpeningBook::~OpeningBook() {
+  if (data != nullptr) {
+    munmap((void*)data, bytes);
+  }
+}
+
+bool OpeningBook::open(const std::string& filename) {
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < HEADER_SIZE) {
+    close(fd);
+    return false;
+  }
+  void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+  const unsigned char *p = (const unsigned char*)mapped;
+  count = read_bytes(p + 8, 4);
+  if (std::memcmp(p, "HWOB", 4) != 0 ||
+      read_bytes(p + 4, 4) != OPENING_BOOK_VERSION ||
+      count > (size_t)(st.st_size - HEADER_SIZE) / ENTRY_SIZE) {
+    munmap(mapped, st.st_size);
+    count = 0;
+    return false;
+  }
+  data = p;
+  bytes = st.st_size;
+  return true;
+}
+
+size_t OpeningBook::size() const {
+  return count;
+}
+
+BookEntry OpeningBook::entry(size_t i) const {
+  const unsigned char *p = data + HEADER_SIZE + i * ENTRY_SIZE;
+  BookEntry entry;
+  for (int w = 0; w < 4; w++) {
+    entry.key.words[w] = read_bytes(p + 8 * w, 8);
+  }
+  entry.setup = Action{0, HOMEWORLD, 0, unpack_pyramid(p[34]), 0,
+    unpack_pyramid(p[32]), unpack_pyramid(p[33])};
+  entry.games = read_bytes(p + 36, 4);
+  entry.points = read_bytes(p + 40, 4);
+  return entry;
+}
+
+std::vector<BookEntry> OpeningBook::find(const PositionKey& key) const {
+  size_t low = 0, high = count;
+  while (low < high) {
+    size_t mid = (low + high) / 2;
+    if (entry(mid).key < key) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  std::vector<BookEntry> result;
+  for (size_t i = low; i < count && entry(i).key == key; i++) {
+    result.push_back(entry(i));
+  }
+  return result;
+}
+
+bool OpeningBook::lookup(const Game& game, Action& setup) const {
+  if (game.num_players() != 2 || game.homeworlds_built() >= 2) {
+    return false;
+  }
+  for (BookEntry& entry : find(encode_position(game))) {
+    entry.setup.player = game.cur_player();
+    if (game.validate_action(entry.setup)) {
+      setup = entry.setup;
+      return true;
+    }
+  }
+  return false;
+}
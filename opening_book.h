@@ -0,0 +1,56 @@
+#ifndef OPENING_BOOK_H
+#define OPENING_BOOK_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "position_key.h"
+
+// Homeworld setups for two player games, scored by self-play and looked up
+// by PositionKey. All integers are little endian.
+//
+//   header  "HWOB", u32 version, u32 entry count
+//   entries sorted by key, then best score first, each 44 bytes:
+//             key (4 u64 words), u8 first star, u8 second star, u8 ship
+//             (size * 4 + colour each), u8 unused, u32 games and u32 half
+//             points for the player to move
+
+const static unsigned int OPENING_BOOK_VERSION = 1;
+
+struct BookEntry {
+  PositionKey key;
+  Action setup; // a HOMEWORLD action
+  int games;
+  int points; // 2 per win and 1 per draw
+
+  double score() const;
+};
+
+// Sorts entries and writes them as a book
+void write_book(std::ostream& os, std::vector<BookEntry> entries);
+
+// Memory-mapped reader
+class OpeningBook {
+  public:
+    OpeningBook();
+    ~OpeningBook();
+
+    bool open(const std::string& filename); // false if missing or malformed
+    size_t size() const;
+    BookEntry entry(size_t i) const;
+
+    // Entries for the position, best first
+    std::vector<BookEntry> find(const PositionKey& key) const;
+    // The best setup for the player to move, false if the book has none or
+    // it is not legal in game
+    bool lookup(const Game& game, Action& setup) const;
+
+  private:
+    const unsigned char *data;
+    size_t bytes;
+    size_t count;
+};
+
+#endif
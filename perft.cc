@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "game.h"
+#include "game_io.h"
+#include "turn.h"
+
+// Counts the leaves of the move tree to a given depth, over single actions
+// (Game::legal_actions) or with -t over whole turns (get_turns). A finished
+// game has no moves. With -d the count is split by root move. -H counts the
+// last ply in bulk and caches subtree counts by position key, so it should
+// agree exactly with the plain count. -j splits the root moves across
+// threads.
+//
+// --check runs every record of a reference table and reports any count that
+// differs. Records are one or more lines "actions|turns <depth> <count>"
+// followed by a game state and a blank line; lines starting with # are
+// comments.
+//
+// Usage: ./perft [-t] [-d] [-H] [-j threads] <depth> < game
+//        ./perft [-H] [-j threads] --check <table>
+
+struct PerftOptions {
+  bool turns = false;
+  bool divide = false;
+  bool hashed = false;
+  int threads = 1;
+};
+
+// Direct-mapped cache of subtree counts
+class PerftTable {
+  public:
+    PerftTable(int size_bits = 18) :
+        entries(1 << size_bits, Entry{0, -1, 0}), mask((1 << size_bits) - 1) {}
+
+    bool probe(unsigned long long key, int depth, unsigned long long& count) {
+      const Entry& entry = entries[key & mask];
+      if (entry.key == key && entry.depth == depth) {
+        count = entry.count;
+        return true;
+      }
+      return false;
+    }
+
+    void store(unsigned long long key, int depth, unsigned long long count) {
+      entries[key & mask] = Entry{key, depth, count};
+    }
+
+  private:
+    struct Entry {
+      unsigned long long key;
+      int depth;
+      unsigned long long count;
+    };
+    std::vector<Entry> entries;
+    unsigned long long mask;
+};
+
+static unsigned long long perft(const Game& game, int depth, bool turns,
+                                PerftTable *table) {
+  if (depth == 0) {
+    return 1;
+  }
+  if (game.winner() != 0) {
+    return 0;
+  }
+  unsigned long long count = 0;
+  if (table != nullptr && depth > 1 && table->probe(game.key(), depth, count)) {
+    return count;
+  }
+
+  if (turns) {
+    std::vector<Turn*> children = get_turns(&game);
+    if (table != nullptr && depth == 1) {
+      count = children.size();
+    } else {
+      for (const Turn *turn : children) {
+        count += perft(*turn->game, depth - 1, turns, table);
+      }
+    }
+    for (Turn *turn : children) {
+      delete turn;
+    }
+  } else {
+    std::vector<Action> actions;
+    game.legal_actions(actions);
+    if (table != nullptr && depth == 1) {
+      count = actions.size();
+    } else {
+      for (Action action : actions) {
+        Game child(game);
+        child.perform_action(action);
+        count += perft(child, depth - 1, turns, table);
+      }
+    }
+  }
+
+  if (table != nullptr && depth > 1) {
+    table->store(game.key(), depth, count);
+  }
+  return count;
+}
+
+struct RootMove {
+  std::string description;
+  Game *game;
+  unsigned long long count;
+};
+
+static std::string describe(const Game& game, const std::vector<Action>& actions,
+                            const std::map<int, std::string>& system_names) {
+  Game copy(game);
+  std::map<int, std::string> names(system_names);
+  std::ostringstream os;
+  print_turn(os, copy, actions, names);
+  std::string text = os.str();
+  text.pop_back();
+  std::replace(text.begin(), text.end(), '\n', ' ');
+  return text;
+}
+
+static std::vector<RootMove> root_moves(const Game& game,
+    const std::map<int, std::string>& system_names, bool turns) {
+  std::vector<RootMove> moves;
+  if (turns) {
+    for (Turn *turn : get_turns(&game)) {
+      std::vector<Action> actions(turn->actions.begin(), turn->actions.end());
+      moves.push_back(RootMove{describe(game, actions, system_names),
+          turn->game, 0});
+      turn->game = nullptr;
+      delete turn;
+    }
+  } else {
+    std::vector<Action> actions;
+    game.legal_actions(actions);
+    for (Action action : actions) {
+      Game *child = new Game(game);
+      child->perform_action(action);
+      moves.push_back(RootMove{describe(game, {action}, system_names),
+          child, 0});
+    }
+  }
+  return moves;
+}
+
+static void worker(std::vector<RootMove> *moves, std::atomic<int> *next,
+                   int depth, const PerftOptions *options) {
+  PerftTable *table = options->hashed ? new PerftTable() : nullptr;
+  for (int i = (*next)++; i < (int)moves->size(); i = (*next)++) {
+    (*moves)[i].count = perft(*(*moves)[i].game, depth - 1, options->turns,
+        table);
+  }
+  delete table;
+}
+
+static unsigned long long run(const Game& game,
+    const std::map<int, std::string>& system_names, int depth,
+    const PerftOptions& options) {
+  if (depth == 0 || game.winner() != 0) {
+    return depth == 0 ? 1 : 0;
+  }
+
+  std::vector<RootMove> moves = root_moves(game, system_names, options.turns);
+  std::atomic<int> next(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < options.threads; i++) {
+    threads.push_back(std::thread(worker, &moves, &next, depth, &options));
+  }
+  unsigned long long total = 0;
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  for (RootMove& move : moves) {
+    if (options.divide) {
+      std::cout << move.description << ": " << move.count << std::endl;
+    }
+    total += move.count;
+    delete move.game;
+  }
+  return total;
+}
+
+static int check(const char *filename, PerftOptions options) {
+  std::ifstream in(filename);
+  if (!in) {
+    std::cerr << "could not open " << filename << std::endl;
+    return 1;
+  }
+  int failures = 0;
+  std::vector<std::string> expectations;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream ls(line);
+    std::string mode;
+    if (line.empty() || line[0] == '#') {
+      continue;
+    } else if (ls >> mode && (mode == "actions" || mode == "turns")) {
+      expectations.push_back(line);
+      continue;
+    }
+
+    std::string text = line + "\n";
+    while (std::getline(in, line) && !line.empty()) {
+      text += line + "\n";
+    }
+    std::istringstream gs(text + "\n");
+    std::map<int, std::string> system_names;
+    Game *game = read_game(gs, system_names);
+    if (game == nullptr) {
+      std::cout << "FAIL malformed position" << std::endl;
+      failures++;
+      expectations.clear();
+      continue;
+    }
+    for (const std::string& expectation : expectations) {
+      std::istringstream es(expectation);
+      int depth;
+      unsigned long long expected;
+      es >> mode >> depth >> expected;
+      options.turns = mode == "turns";
+      unsigned long long count = run(*game, system_names, depth, options);
+      std::cout << (count == expected ? "ok " : "FAIL ") << expectation;
+      if (count != expected) {
+        std::cout << " got " << count;
+        failures++;
+      }
+      std::cout << std::endl;
+    }
+    expectations.clear();
+    delete game;
+  }
+  return failures == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+  PerftOptions options;
+  int depth = -1;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-t") {
+      options.turns = true;
+    } else if (arg == "-d") {
+      options.divide = true;
+    } else if (arg == "-H") {
+      options.hashed = true;
+    } else if (arg == "-j" && i + 1 < argc) {
+      options.threads = std::max(1, std::atoi(argv[++i]));
+    } else if (arg == "--check" && i + 1 < argc) {
+      return check(argv[++i], options);
+    } else {
+      depth = std::atoi(argv[i]);
+    }
+  }
+  if (depth < 0) {
+    std::cerr << "usage: ./perft [-t] [-d] [-H] [-j threads] <depth> < game"
+      << std::endl;
+    std::cerr << "       ./perft [-H] [-j threads] --check <table>" << std::endl;
+    return 1;
+  }
+
+  std::map<int, std::string> system_names;
+  Game *game = read_game(std::cin, system_names);
+  if (game == nullptr) {
+    std::cerr << "malformed game" << std::endl;
+    return 1;
+  }
+  auto start = std::chrono::steady_clock::now();
+  unsigned long long nodes = run(*game, system_names, depth, options);
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  std::cout << "nodes " << nodes << " seconds " << elapsed.count()
+    << " nodes/sec " << nodes / elapsed.count() << std::endl;
+  delete game;
+}
@@ -0,0 +1,237 @@
+#include "playout.h"
+
+Rng::Rng(unsigned long long seed) : state(seed != 0 ? seed : 0x9e3779b97f4a7c15ULL) {}
+
+unsigned long long Rng::next() {
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+  return state * 0x2545f4914f6cdd1dULL;
+}
+
+unsigned int Rng::below(unsigned int n) {
+  return (unsigned int)(((next() >> 32) * n) >> 32);
+}
+
+// Weighted reservoir sampling over actions as they are enumerated, so only
+// the chosen action is ever stored.
+struct Sampler {
+  Rng& rng;
+  const PlayoutPolicy& policy;
+  Action chosen;
+  unsigned int total;
+
+  void consider(const Action& action) {
+    unsigned int weight = policy.weights[action.type];
+    if (weight == 0) {
+      return;
+    }
+    total += weight;
+    if (rng.below(total) < weight) {
+      chosen = action;
+    }
+  }
+};
+
+// Pyramid types are bits (size * 4 + colour) of a mask
+static Pyramid pyramid_of(int type) {
+  return Pyramid{(Size)(type >> 2), (Colour)(type & 3)};
+}
+
+static int enemy_types(const System& system, int player) {
+  int mask = 0;
+  for (int other = 0; other <= MAX_PLAYERS; other++) {
+    if (other != player) {
+      mask |= system.ship_types[other];
+    }
+  }
+  return mask;
+}
+
+static void load_bank(const Game& game, int bank[4][4]) {
+  for (const auto& it : game.stash()) {
+    bank[it.first.size][it.first.colour] = it.second;
+  }
+}
+
+// Offers every action available to player to the sampler. Main actions use
+// the colours available in each system; sacrifice actions use only colour.
+static void sample_actions(const Game& game, const int bank[4][4], int player,
+                           bool main, Colour colour, Sampler& sampler) {
+  for (const System& system : game.systems()) {
+    int own = system.ship_types[player];
+    if (own == 0) {
+      continue;
+    }
+
+    for (Colour c : { RED, YELLOW, GREEN, BLUE }) {
+      if (main ? !colour_available(system, player, c) : c != colour) {
+        continue;
+      }
+
+      switch (c) {
+        case RED: {
+            int largest = 0;
+            for (int t = 4; t < 16; t++) {
+              if (own & (1 << t)) {
+                largest = t >> 2;
+              }
+            }
+            int enemy = enemy_types(system, player);
+            for (int t = 4; t < (largest + 1) * 4; t++) {
+              if (enemy & (1 << t)) {
+                sampler.consider(
+                    Action{player, ATTACK, system.id, pyramid_of(t)});
+              }
+            }
+          }
+          break;
+
+        case YELLOW:
+          for (int b = 4; b < 16; b++) {
+            Pyramid target = pyramid_of(b);
+            if (bank[target.size][target.colour] == 0 ||
+                !connected(system, target)) {
+              continue;
+            }
+            for (int t = 4; t < 16; t++) {
+              if (own & (1 << t)) {
+                sampler.consider(Action{player, DISCOVER, system.id,
+                    pyramid_of(t), 0, target});
+              }
+            }
+          }
+          for (const System& to_system : game.systems()) {
+            if (!connected(system, to_system)) {
+              continue;
+            }
+            for (int t = 4; t < 16; t++) {
+              if (own & (1 << t)) {
+                sampler.consider(Action{player, TRAVEL, system.id,
+                    pyramid_of(t), to_system.id});
+              }
+            }
+          }
+          break;
+
+        case GREEN:
+          for (Colour k : { RED, YELLOW, GREEN, BLUE }) {
+            if ((own & (0x1110 << k)) == 0) {
+              continue;
+            }
+            for (Size s : { SMALL, MEDIUM, LARGE }) {
+              if (bank[s][k] > 0) {
+                sampler.consider(
+                    Action{player, BUILD, system.id, Pyramid{s, k}});
+                break;
+              }
+            }
+          }
+          break;
+
+        case BLUE:
+          for (int t = 4; t < 16; t++) {
+            if ((own & (1 << t)) == 0) {
+              continue;
+            }
+            Pyramid ship = pyramid_of(t);
+            for (Colour k : { RED, YELLOW, GREEN, BLUE }) {
+              if (k != ship.colour && bank[ship.size][k] > 0) {
+                sampler.consider(Action{player, TRADE, system.id, ship, 0,
+                    Pyramid{ship.size, k}});
+              }
+            }
+          }
+          break;
+      }
+    }
+
+    if (main) {
+      for (int t = 4; t < 16; t++) {
+        if (own & (1 << t)) {
+          sampler.consider(
+              Action{player, SACRIFICE, system.id, pyramid_of(t)});
+        }
+      }
+    }
+  }
+}
+
+static void perform(Game& game, Action action, std::vector<Action> *trace) {
+  if (trace != nullptr) {
+    trace->push_back(action);
+  }
+  game.perform_action(action);
+}
+
+bool random_turn(Game& game, Rng& rng, const PlayoutPolicy& policy,
+                 std::vector<Action> *trace) {
+  int player = game.cur_player();
+  int bank[4][4] = {{0}};
+
+  if (game.homeworlds_built() < game.num_players()) {
+    if (!game.done_main_action()) {
+      std::vector<Action> setups;
+      game.legal_actions(setups);
+      if (setups.empty()) {
+        return false;
+      }
+      perform(game, setups[rng.below(setups.size())], trace);
+    }
+    perform(game, Action{player, PASS}, trace);
+    return true;
+  }
+
+  if (!game.done_main_action()) {
+    Sampler sampler{rng, policy, Action{player, PASS}, 0};
+    load_bank(game, bank);
+    sample_actions(game, bank, player, true, RED, sampler);
+    if (sampler.total == 0) {
+      return false;
+    }
+    perform(game, sampler.chosen, trace);
+  }
+
+  while (game.sacrifice_actions() > 0) {
+    Sampler sampler{rng, policy, Action{player, PASS},
+      (unsigned int)policy.weights[PASS]};
+    load_bank(game, bank);
+    sample_actions(game, bank, player, false, game.sacrifice_colour(), sampler);
+    if (sampler.chosen.type == PASS) {
+      break;
+    }
+    perform(game, sampler.chosen, trace);
+  }
+
+  unsigned int fire = policy.weights[CATASTROPHE];
+  unsigned int odds = fire + policy.weights[PASS];
+  const std::vector<System>& systems = game.systems();
+  for (unsigned int i = 0; fire > 0 && i < systems.size(); ) {
+    int id = systems[i].id;
+    for (Colour c : { RED, YELLOW, GREEN, BLUE }) {
+      if (systems[i].colour_counts[c] >= 4 && rng.below(odds) < fire) {
+        perform(game,
+            Action{player, CATASTROPHE, id, Pyramid{ZERO, c}}, trace);
+        if (i >= systems.size() || systems[i].id != id) {
+          break;
+        }
+      }
+    }
+    if (i < systems.size() && systems[i].id == id) {
+      i++;
+    }
+  }
+
+  perform(game, Action{player, PASS}, trace);
+  return true;
+}
+
+int random_playout(Game& game, Rng& rng, const PlayoutPolicy& policy,
+                   int max_turns) {
+  for (int i = 0; i < max_turns && game.winner() == 0; i++) {
+    if (!random_turn(game, rng, policy)) {
+      return 0;
+    }
+  }
+  return game.winner();
+}
@@ -0,0 +1,45 @@
+#ifndef PLAYOUT_H
+#define PLAYOUT_H
+
+#include <vector>
+
+#include "game.h"
+
+// Small, fast, seedable PRNG (xorshift64*) for simulations.
+class Rng {
+  public:
+    Rng(unsigned long long seed = 1);
+
+    unsigned long long next();
+    unsigned int below(unsigned int n); // uniform in [0, n)
+
+  private:
+    unsigned long long state;
+};
+
+// Relative weights of each ActionType when sampling a turn. A sacrifice is
+// sampled as a single choice and its follow-up actions are sampled from the
+// sacrificed colour with the PASS weight as the chance of stopping early.
+// Available catastrophes fire with probability
+// CATASTROPHE / (CATASTROPHE + PASS).
+struct PlayoutPolicy {
+  int weights[8];
+};
+
+const PlayoutPolicy UNIFORM_POLICY = {{1, 1, 1, 1, 1, 1, 1, 1}};
+
+// Samples a legal full turn for the current player and performs it in place,
+// without building the list of legal actions (except for homeworld setups,
+// which are picked uniformly). Performed actions are appended
+// to trace if given. Returns false if the player had no legal turn.
+bool random_turn(Game& game, Rng& rng,
+                 const PlayoutPolicy& policy = UNIFORM_POLICY,
+                 std::vector<Action> *trace = nullptr);
+
+// Plays random turns until the game ends or max_turns have been played.
+// Returns the winner, or 0 if the game did not finish.
+int random_playout(Game& game, Rng& rng,
+                   const PlayoutPolicy& policy = UNIFORM_POLICY,
+                   int max_turns = 200);
+
+#endif
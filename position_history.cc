@@ -0,0 +1,40 @@
+#include "position_history.h"
+
+PositionHistory::PositionHistory(int filter_bits) :
+    filter(1ULL << filter_bits, 0), mask((1ULL << filter_bits) - 1) {}
+
+void PositionHistory::push(unsigned long long key) {
+  keys.push_back(key);
+  filter[key & mask]++;
+}
+
+void PositionHistory::pop() {
+  filter[keys.back() & mask]--;
+  keys.pop_back();
+}
+
+void PositionHistory::clear() {
+  for (unsigned long long key : keys) {
+    filter[key & mask]--;
+  }
+  keys.clear();
+}
+
+size_t PositionHistory::size() const {
+  return keys.size();
+}
+
+unsigned long long PositionHistory::back() const {
+  return keys.back();
+}
+
+int PositionHistory::count(unsigned long long key) const {
+  if (filter[key & mask] == 0) {
+    return 0;
+  }
+  int n = 0;
+  for (unsigned long long k : keys) {
+    n += k == key;
+  }
+  return n;
+}
@@ -0,0 +1,29 @@
+#ifndef POSITION_HISTORY_H
+#define POSITION_HISTORY_H
+
+#include <cstddef>
+#include <vector>
+
+// Stack of Game::key()s of the positions a game or search path has gone
+// through, for detecting repetitions. A small table counts keys by their low
+// bits, so looking up a position that was never reached, the usual case,
+// costs one load; the stack is only scanned when the table has a match.
+class PositionHistory {
+  public:
+    PositionHistory(int filter_bits = 12);
+
+    void push(unsigned long long key);
+    void pop();
+    void clear();
+    size_t size() const;
+    unsigned long long back() const;
+
+    int count(unsigned long long key) const; // occurrences on the stack
+
+  private:
+    std::vector<unsigned long long> keys;
+    std::vector<unsigned short> filter;
+    unsigned long long mask;
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <cassert>
+
+#include "position_key.h"
+
+const static int PYRAMIDS = 12;
+const static int COPIES = 3;
+const static int STATE_BIT = 6 * PYRAMIDS * COPIES;
+
+static void set_bits(PositionKey& key, int bit, int width, unsigned int value) {
+  for (int i = 0; i < width; i++, bit++) {
+    if (value >> i & 1) {
+      key.words[bit / 64] |= 1ULL << (bit % 64);
+    }
+  }
+}
+
+static unsigned int get_bits(const PositionKey& key, int bit, int width) {
+  unsigned int value = 0;
+  for (int i = 0; i < width; i++, bit++) {
+    value |= (unsigned int)(key.words[bit / 64] >> (bit % 64) & 1) << i;
+  }
+  return value;
+}
+
+static int pyramid_index(const Pyramid& pyramid) {
+  return (pyramid.size - 1) * 4 + pyramid.colour;
+}
+
+// Sorted piece codes, stars first; identical systems compare equal
+static std::vector<int> contents(const System& system) {
+  std::vector<int> codes;
+  for (const Pyramid& star : system.stars) {
+    codes.push_back(pyramid_index(star));
+  }
+  for (const Ship& ship : system.ships) {
+    codes.push_back(PYRAMIDS * ship.player + pyramid_index(ship.pyramid));
+  }
+  std::sort(codes.begin(), codes.end());
+  return codes;
+}
+
+bool operator==(const PositionKey& lhs, const PositionKey& rhs) {
+  return std::equal(lhs.words, lhs.words + 4, rhs.words);
+}
+
+bool operator!=(const PositionKey& lhs, const PositionKey& rhs) {
+  return !(lhs == rhs);
+}
+
+bool operator<(const PositionKey& lhs, const PositionKey& rhs) {
+  return std::lexicographical_compare(lhs.words, lhs.words + 4,
+      rhs.words, rhs.words + 4);
+}
+
+PositionKey encode_position(const Game& game) {
+  assert(game.num_players() == 2);
+
+  // Homeworlds first, then the other systems by contents
+  std::vector<std::pair<std::vector<int>, const System*> > others;
+  const System *homes[2] = {nullptr, nullptr};
+  for (const System& system : game.systems()) {
+    if (system.player != 0) {
+      homes[system.player - 1] = &system;
+    } else {
+      others.push_back(std::make_pair(contents(system), &system));
+    }
+  }
+  std::sort(others.begin(), others.end());
+  std::vector<const System*> order(homes, homes + 2);
+  for (const auto& other : others) {
+    order.push_back(other.second);
+  }
+
+  std::vector<int> locations[PYRAMIDS];
+  for (unsigned int i = 0; i < order.size(); i++) {
+    if (order[i] == nullptr) {
+      continue;
+    }
+    for (const Pyramid& star : order[i]->stars) {
+      locations[pyramid_index(star)].push_back(i * 3);
+    }
+    for (const Ship& ship : order[i]->ships) {
+      locations[pyramid_index(ship.pyramid)].push_back(i * 3 + ship.player);
+    }
+  }
+
+  PositionKey key = PositionKey();
+  for (int p = 0; p < PYRAMIDS; p++) {
+    locations[p].resize(COPIES, POSITION_KEY_BANK);
+    std::sort(locations[p].begin(), locations[p].end());
+    for (int copy = 0; copy < COPIES; copy++) {
+      set_bits(key, 6 * (p * COPIES + copy), 6, locations[p][copy]);
+    }
+  }
+  set_bits(key, STATE_BIT, 2, game.cur_player());
+  set_bits(key, STATE_BIT + 2, 2, game.homeworlds_built());
+  set_bits(key, STATE_BIT + 4, 1, game.done_main_action());
+  set_bits(key, STATE_BIT + 5, 2, game.sacrifice_actions());
+  set_bits(key, STATE_BIT + 7, 2, game.sacrifice_colour());
+  return key;
+}
+
+Game *decode_position(const PositionKey& key) {
+  const int max_systems = POSITION_KEY_BANK / 3;
+  std::vector<Pyramid> stars[max_systems];
+  std::vector<Ship> ships[max_systems];
+  for (int p = 0; p < PYRAMIDS; p++) {
+    Pyramid pyramid = Pyramid{(Size)(p / 4 + 1), (Colour)(p % 4)};
+    for (int copy = 0; copy < COPIES; copy++) {
+      int location = get_bits(key, 6 * (p * COPIES + copy), 6);
+      if (location == POSITION_KEY_BANK) {
+        continue;
+      }
+      if (location % 3 == 0) {
+        stars[location / 3].push_back(pyramid);
+      } else {
+        ships[location / 3].push_back(Ship{location % 3, pyramid});
+      }
+    }
+  }
+
+  Game *g = new Game(2);
+  for (int i = 0; i < max_systems; i++) {
+    if (stars[i].empty() && ships[i].empty()) {
+      continue;
+    }
+    int system_id = g->create_system(stars[i], i < 2 ? i + 1 : 0);
+    for (const Ship& ship : ships[i]) {
+      g->add_ship(system_id, ship);
+    }
+  }
+  g->set_cur_player(get_bits(key, STATE_BIT, 2));
+  g->set_homeworlds_built(get_bits(key, STATE_BIT + 2, 2));
+  g->set_done_main_action(get_bits(key, STATE_BIT + 4, 1));
+  g->set_sacrifice_actions(get_bits(key, STATE_BIT + 5, 2));
+  g->set_sacrifice_colour((Colour)get_bits(key, STATE_BIT + 7, 2));
+  return g;
+}
+
+unsigned long long hash(const PositionKey& key) {
+  unsigned long long h = 0x9e3779b97f4a7c15ULL;
+  for (int i = 0; i < 4; i++) {
+    h = (h ^ key.words[i]) * 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 31;
+  }
+  return h;
+}
@@ -0,0 +1,45 @@
+#ifndef POSITION_KEY_H
+#define POSITION_KEY_H
+
+#include <functional>
+
+#include "game.h"
+
+// Canonical 256-bit key of a two player position. Unlike Game::key it is
+// exact, and unlike Game::hash_string it can be decoded back into a Game.
+//
+// A two player game has 36 pyramids, three of each size and colour. Each is
+// given a 6-bit location, system index * 3 + kind (0 star, 1 ship of player
+// 1, 2 ship of player 2), or 63 while in the bank. Homeworlds of players 1
+// and 2 have system indices 0 and 1 whether or not they exist, and the other
+// systems follow sorted by their contents, so the key does not depend on
+// system ids or the order of systems, stars and ships. Locations take bits
+// 6 * (pyramid * 3 + copy) of words, pyramid being size * 4 + colour - 4,
+// with the copies of a pyramid in increasing order. Bits 216 and up hold
+// the player to move, homeworlds built, whether the main action is done and
+// the pending sacrifice actions and colour.
+
+const static int POSITION_KEY_BANK = 63;
+
+struct PositionKey {
+  unsigned long long words[4];
+};
+
+bool operator==(const PositionKey& lhs, const PositionKey& rhs);
+bool operator!=(const PositionKey& lhs, const PositionKey& rhs);
+bool operator<(const PositionKey& lhs, const PositionKey& rhs);
+
+PositionKey encode_position(const Game& game); // game must have two players
+Game *decode_position(const PositionKey& key);
+unsigned long long hash(const PositionKey& key);
+
+namespace std {
+  template <>
+  struct hash<PositionKey> {
+    size_t operator()(const PositionKey& key) const {
+      return (size_t)::hash(key);
+    }
+  };
+}
+
+#endif
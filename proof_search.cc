@@ -0,0 +1,205 @@
+#include <algorithm>
+
+#include "proof_search.h"
+#include "trace.h"
+#include "turn.h"
+
+ProofSearch::ProofSearch(int table_mb) :
+    table(std::max((size_t)1,
+          (size_t)std::max(table_mb, 0) * 1024 * 1024 / sizeof(ProofEntry))),
+    attacker(0), node_count(0), node_limit(0), stop_flag(false),
+    deadline(Deadline::max()) {
+  clear();
+}
+
+const std::vector<std::vector<Action>>& ProofSearch::line() const {
+  return proof_line;
+}
+
+void ProofSearch::set_deadline(Deadline deadline) {
+  this->deadline = deadline;
+}
+
+void ProofSearch::stop() {
+  stop_flag = true;
+}
+
+void ProofSearch::resume() {
+  stop_flag = false;
+  deadline = Deadline::max();
+}
+
+void ProofSearch::clear() {
+  std::fill(table.begin(), table.end(), ProofEntry{0, -1, false, 0, 0, 0});
+}
+
+long long ProofSearch::nodes() const {
+  return node_count;
+}
+
+ProofResult ProofSearch::solve(const Game *game, int max_turns,
+                               long long max_nodes) {
+  proof_line.clear();
+  if (game->num_players() != 2 || game->winner() != 0 || max_turns <= 0) {
+    return DISPROVEN;
+  }
+  attacker = game->cur_player();
+  node_limit = node_count + max_nodes;
+  unsigned int phi, delta;
+  lookup(game, max_turns, phi, delta);
+  if (phi != 0 && delta != 0) {
+    mid(game, max_turns, PROOF_INFINITY, PROOF_INFINITY, phi, delta);
+  }
+  if (phi == 0) {
+    build_line(game, max_turns);
+    return PROVEN;
+  }
+  return delta == 0 ? DISPROVEN : UNKNOWN;
+}
+
+bool ProofSearch::out_of_time() {
+  if (!stop_flag && deadline != Deadline::max() &&
+      std::chrono::steady_clock::now() >= deadline) {
+    stop_flag = true;
+  }
+  return stop_flag;
+}
+
+static size_t slot(unsigned long long key, int turns, bool attacking,
+                   size_t size) {
+  return (key ^ (unsigned long long)(turns * 2 + attacking) *
+      0x9e3779b97f4a7c15ULL) % size;
+}
+
+const ProofEntry *ProofSearch::find(const Game *game, int turns) const {
+  unsigned long long key = game->key();
+  bool attacking = game->cur_player() == attacker;
+  const ProofEntry& entry = table[slot(key, turns, attacking, table.size())];
+  if (entry.key == key && entry.turns == turns &&
+      entry.attacking == attacking) {
+    return &entry;
+  }
+  return nullptr;
+}
+
+// The attacker's goal is to win within the turns left, the defender's is to
+// survive them
+void ProofSearch::lookup(const Game *game, int turns, unsigned int& phi,
+                         unsigned int& delta) const {
+  int winner = game->winner();
+  if (winner != 0 || turns == 0) {
+    bool attacking = game->cur_player() == attacker;
+    bool goal = attacking == (winner == attacker);
+    phi = goal ? 0 : PROOF_INFINITY;
+    delta = goal ? PROOF_INFINITY : 0;
+    return;
+  }
+  const ProofEntry *entry = find(game, turns);
+  phi = entry != nullptr ? entry->phi : 1;
+  delta = entry != nullptr ? entry->delta : 1;
+}
+
+void ProofSearch::store(const Game *game, int turns, unsigned int phi,
+                        unsigned int delta, long long work) {
+  unsigned long long key = game->key();
+  bool attacking = game->cur_player() == attacker;
+  ProofEntry& entry = table[slot(key, turns, attacking, table.size())];
+  bool same = entry.key == key && entry.turns == turns &&
+    entry.attacking == attacking;
+  if (same || entry.turns < 0 || work >= entry.work) {
+    entry = ProofEntry{key, turns, attacking, phi, delta, work};
+  }
+}
+
+// Expands game until its proof or disproof number reaches its threshold,
+// and returns the number of positions expanded
+long long ProofSearch::mid(const Game *game, int turns,
+                           unsigned int phi_threshold,
+                           unsigned int delta_threshold, unsigned int& phi,
+                           unsigned int& delta) {
+  TRACE_SCOPE_ARG("mid", "turns", turns);
+  node_count++;
+  long long work = 1;
+  bool descended = false;
+  std::vector<Turn*> children = get_turns(game);
+  std::vector<unsigned int> phis(children.size()), deltas(children.size());
+  for (size_t i = 0; i < children.size(); i++) {
+    lookup(children[i]->game, turns - 1, phis[i], deltas[i]);
+  }
+
+  while (true) {
+    // Reaching the goal needs one child to fail, failing needs all to
+    // reach theirs
+    phi = PROOF_INFINITY;
+    delta = 0;
+    unsigned int second = PROOF_INFINITY;
+    size_t best = 0;
+    for (size_t i = 0; i < children.size(); i++) {
+      if (deltas[i] < phi) {
+        second = phi;
+        phi = deltas[i];
+        best = i;
+      } else if (deltas[i] < second) {
+        second = deltas[i];
+      }
+      delta = std::min(PROOF_INFINITY, delta + phis[i]);
+    }
+    // The node budget is checked after one descent, so every call reaches
+    // at least one new position
+    if (phi >= phi_threshold || delta >= delta_threshold || out_of_time() ||
+        (descended && node_count >= node_limit)) {
+      break;
+    }
+
+    unsigned int child_phi_threshold = delta_threshold - (delta - phis[best]);
+    unsigned int child_delta_threshold =
+      std::min(phi_threshold, std::min(PROOF_INFINITY - 1, second) + 1);
+    work += mid(children[best]->game, turns - 1, child_phi_threshold,
+        child_delta_threshold, phis[best], deltas[best]);
+    descended = true;
+  }
+
+  for (Turn *turn : children) {
+    delete turn;
+  }
+  store(game, turns, phi, delta, work);
+  return work;
+}
+
+void ProofSearch::build_line(const Game *game, int turns) {
+  Game *current = new Game(*game);
+  for (; turns > 0 && current->winner() == 0; turns--) {
+    bool attacking = current->cur_player() == attacker;
+    std::vector<Turn*> children = get_turns(current);
+    const Turn *chosen = nullptr;
+    long long chosen_work = 0;
+    for (const Turn *turn : children) {
+      unsigned int phi, delta;
+      lookup(turn->game, turns - 1, phi, delta);
+      const ProofEntry *entry = find(turn->game, turns - 1);
+      long long work = entry != nullptr ? entry->work : 0;
+      if (attacking && delta == 0 &&
+          (chosen == nullptr || work < chosen_work)) {
+        chosen = turn;
+        chosen_work = work;
+      } else if (!attacking && (chosen == nullptr || work > chosen_work)) {
+        chosen = turn;
+        chosen_work = work;
+      }
+    }
+
+    if (chosen != nullptr) {
+      proof_line.push_back(std::vector<Action>(chosen->actions.begin(),
+            chosen->actions.end()));
+      delete current;
+      current = new Game(*chosen->game);
+    }
+    for (Turn *turn : children) {
+      delete turn;
+    }
+    if (chosen == nullptr) {
+      break;
+    }
+  }
+  delete current;
+}
@@ -0,0 +1,76 @@
+#ifndef PROOF_SEARCH_H
+#define PROOF_SEARCH_H
+
+#include <atomic>
+#include <vector>
+
+#include "game.h"
+#include "negamax.h"
+
+// Depth-first proof-number search (df-pn) for forced wins of two player
+// games. The player to move at the root is the attacker, who must win
+// within a number of turns, counting both players' turns; the defender
+// only has to survive them. Each node is a whole turn, as generated by
+// get_turns. Proof and disproof numbers are kept in a transposition table
+// of fixed size, so memory stays bounded however long the search runs.
+//
+// Successive calls to solve on the same position continue where the last
+// one stopped, which lets a caller run the search in slices between other
+// work.
+
+enum ProofResult { PROVEN, DISPROVEN, UNKNOWN };
+
+const static unsigned int PROOF_INFINITY = 100000000;
+
+struct ProofEntry {
+  unsigned long long key; // Game::key
+  int turns; // left in the search, or -1 if the entry is empty
+  bool attacking; // whether the player to move is the attacker
+  unsigned int phi; // proof number for the player to move reaching their goal
+  unsigned int delta; // disproof number
+  long long work; // positions expanded below, to decide replacement
+};
+
+class ProofSearch {
+  public:
+    ProofSearch(int table_mb = 16);
+
+    // Tries to prove that the player to move in game wins within max_turns.
+    // Stops after max_nodes more positions, but not before reaching at
+    // least one new position, so repeated calls always make progress.
+    ProofResult solve(const Game *game, int max_turns, long long max_nodes);
+    // After PROVEN, the attacker's winning turns and in between the
+    // defender's replies with the largest proofs. It may stop early if the
+    // table has lost part of the proof.
+    const std::vector<std::vector<Action>>& line() const;
+
+    // Stopping is safe from other threads, like Negamax::stop
+    void set_deadline(Deadline deadline);
+    void stop();
+    void resume(); // clears the stop flag and the deadline
+    void clear(); // forgets all proofs
+
+    long long nodes() const; // positions expanded since construction
+
+  private:
+    std::vector<ProofEntry> table;
+    int attacker;
+    long long node_count;
+    long long node_limit;
+    std::atomic<bool> stop_flag;
+    Deadline deadline;
+    std::vector<std::vector<Action>> proof_line;
+
+    bool out_of_time();
+    void lookup(const Game *game, int turns, unsigned int& phi,
+                unsigned int& delta) const;
+    void store(const Game *game, int turns, unsigned int phi,
+               unsigned int delta, long long work);
+    const ProofEntry *find(const Game *game, int turns) const;
+    long long mid(const Game *game, int turns, unsigned int phi_threshold,
+                  unsigned int delta_threshold, unsigned int& phi,
+                  unsigned int& delta);
+    void build_line(const Game *game, int turns);
+};
+
+#endif
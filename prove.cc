@@ -0,0 +1,67 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "game.h"
+#include "game_io.h"
+#include "proof_search.h"
+
+// Looks for a forced win for the player to move in the game state given as
+// input with proof-number search (see proof_search.h). Prints the result,
+// and for a win the proof's line of play, one turn per block of actions.
+//
+// Usage: ./prove [-d max turns] [-n max positions] [-m table MB] < game
+
+int main(int argc, char *argv[]) {
+  int max_turns = 3;
+  long long max_nodes = 100000;
+  int table_mb = 64;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    if (arg == "-d") {
+      max_turns = std::max(1, std::atoi(argv[i + 1]));
+    } else if (arg == "-n") {
+      max_nodes = std::max(1LL, std::atoll(argv[i + 1]));
+    } else if (arg == "-m") {
+      table_mb = std::max(1, std::atoi(argv[i + 1]));
+    } else {
+      std::cerr << "usage: ./prove [-d max turns] [-n max positions] "
+        "[-m table MB] < game" << std::endl;
+      return 1;
+    }
+  }
+
+  std::map<int, std::string> system_names;
+  Game *g = read_game(std::cin, system_names);
+  if (g == nullptr) {
+    std::cerr << "malformed game" << std::endl;
+    return 1;
+  }
+  if (g->num_players() != 2) {
+    std::cerr << "proof search needs a two player game" << std::endl;
+    delete g;
+    return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  ProofSearch search(table_mb);
+  ProofResult result = search.solve(g, max_turns, max_nodes);
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  if (result == PROVEN) {
+    std::cout << "win in " << search.line().size() << " turns";
+  } else if (result == DISPROVEN) {
+    std::cout << "no win in " << max_turns << " turns";
+  } else {
+    std::cout << "unknown";
+  }
+  std::cout << " positions " << search.nodes() << " seconds " <<
+    elapsed.count() << std::endl;
+
+  for (const std::vector<Action>& turn : search.line()) {
+    std::cout << std::endl;
+    print_turn(std::cout, *g, turn, system_names);
+  }
+  delete g;
+  return result == UNKNOWN ? 2 : 0;
+}
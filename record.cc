@@ -0,0 +1,152 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "game.h"
+#include "game_io.h"
+#include "game_record.h"
+
+// Converts game records between the text format written by selfplay and the
+// binary format of game_record.h, and replays binary records.
+//
+// Text records are a line "game <n> A <label> result <winner> turns <t>", a
+// game state and the actions of t turns, each turn followed by a blank line.
+// System names do not survive a round trip through the binary format.
+//
+// Usage: ./record text2bin <text records> <binary records>
+//        ./record bin2text <binary records> <text records>
+//        ./record stats <binary records>
+
+static int text_to_binary(std::istream& in, std::ofstream& out) {
+  GameRecordWriter writer(out);
+  std::string line;
+  int games = 0;
+  while (std::getline(in, line)) {
+    std::istringstream header(line);
+    std::string word, a, result, turns_word;
+    int number, label, winner, turns;
+    if (!(header >> word >> number >> a >> label >> result >> winner >>
+          turns_word >> turns) || word != "game") {
+      continue;
+    }
+
+    std::map<int, std::string> system_names;
+    Game *initial = read_game(in, system_names);
+    if (initial == nullptr) {
+      std::cerr << "skipping malformed game " << number << std::endl;
+      continue;
+    }
+    Game game(*initial);
+    std::vector<Action> actions;
+    for (int passes = 0; passes < turns && in >> std::ws && !in.eof(); ) {
+      Action action;
+      std::string system_name = read_action(in, action, system_names);
+      action.player = game.cur_player();
+      actions.push_back(action);
+      game.perform_action(action);
+      if (action.type == DISCOVER || action.type == HOMEWORLD) {
+        system_names.emplace(action.system_target, system_name);
+      } else if (action.type == PASS) {
+        passes++;
+      }
+    }
+    writer.add(*initial, actions, winner, label);
+    delete initial;
+    games++;
+  }
+  writer.finish();
+  std::cerr << "games " << games << std::endl;
+  return 0;
+}
+
+static void binary_to_text(const GameRecordReader& reader, std::ostream& out) {
+  for (size_t i = 0; i < reader.num_games(); i++) {
+    Game *game = reader.initial_game(i);
+    std::map<int, std::string> system_names;
+    int other = 1;
+    for (const System& system : game->systems()) {
+      system_names.emplace(system.id, system.player != 0 ?
+          "Home" + std::to_string(system.player) :
+          "System" + std::to_string(other++));
+    }
+
+    std::ostringstream turns_text;
+    int turns = 0;
+    const unsigned char *packed = reader.actions(i);
+    for (int a = 0; a < reader.num_actions(i); a++) {
+      Action action = unpack_action(
+          GameRecordReader::read_u32(packed + 4 * a), *game);
+      if (!game->validate_action(action)) {
+        std::cerr << "game " << i << " stops at illegal action " << a
+          << std::endl;
+        break;
+      }
+      print_turn(turns_text, *game, {action}, system_names);
+      if (action.type == PASS) {
+        turns_text << std::endl;
+        turns++;
+      }
+    }
+    delete game;
+
+    out << "game " << i << " A " << reader.label(i) << " result "
+      << reader.winner(i) << " turns " << turns << std::endl;
+    Game *initial = reader.initial_game(i);
+    print_game(out, *initial, system_names);
+    delete initial;
+    out << turns_text.str();
+  }
+}
+
+static void stats(const GameRecordReader& reader) {
+  auto start = std::chrono::steady_clock::now();
+  long long positions = 0;
+  int draws = 0;
+  int illegal = 0;
+  for (size_t i = 0; i < reader.num_games(); i++) {
+    illegal += !reader.replay(i, [&positions](const Game&, const Action&) {
+          positions++;
+        });
+    draws += reader.winner(i) == 0;
+  }
+  std::chrono::duration<double> elapsed =
+    std::chrono::steady_clock::now() - start;
+  std::cout << "games " << reader.num_games() << " actions " << positions
+    << " draws " << draws << " illegal " << illegal << " seconds "
+    << elapsed.count() << " actions/sec " << positions / elapsed.count() << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  std::string command = argc > 1 ? argv[1] : "";
+  if (command == "text2bin" && argc > 3) {
+    std::ifstream in(argv[2]);
+    std::ofstream out(argv[3], std::ios::binary);
+    if (!in || !out) {
+      std::cerr << "could not open " << (in ? argv[3] : argv[2]) << std::endl;
+      return 1;
+    }
+    return text_to_binary(in, out);
+  } else if ((command == "bin2text" && argc > 3) ||
+             (command == "stats" && argc > 2)) {
+    GameRecordReader reader;
+    if (!reader.open(argv[2])) {
+      std::cerr << "could not read game records from " << argv[2] << std::endl;
+      return 1;
+    }
+    if (command == "stats") {
+      stats(reader);
+      return 0;
+    }
+    std::ofstream out(argv[3]);
+    binary_to_text(reader, out);
+    return 0;
+  }
+
+  std::cerr << "usage: ./record text2bin <text records> <binary records>"
+    << std::endl;
+  std::cerr << "       ./record bin2text <binary records> <text records>"
+    << std::endl;
+  std::cerr << "       ./record stats <binary records>" << std::endl;
+  return 1;
+}
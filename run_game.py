@@ -8,10 +8,46 @@ def run_process(args, stdin):
   result = p.communicate(input=stdin.encode("utf-8"))[0]
   return result.decode("utf-8")
 
+class Engine:
+  """A long-lived ./engine process, which keeps its search state between
+  moves."""
+
+  def __init__(self, args, movetime, ponder=False):
+    self.process = subprocess.Popen(args, stdin=subprocess.PIPE,
+        stdout=subprocess.PIPE, universal_newlines=True)
+    self.movetime = movetime
+    if ponder:
+      self.send("setoption name Ponder value true\n")
+
+  def send(self, text):
+    self.process.stdin.write(text)
+    self.process.stdin.flush()
+
+  def get_move(self, game):
+    self.send("position\n" + game + "\n\n")
+    self.send("go movetime {}\n".format(self.movetime))
+    while self.process.stdout.readline().strip() != "bestmove":
+      pass
+    lines = []
+    line = self.process.stdout.readline()
+    while line.strip() != "":
+      lines.append(line)
+      line = self.process.stdout.readline()
+    return "".join(lines)
+
+  def quit(self):
+    self.send("quit\n")
+    self.process.wait()
+
 # returns move, new_game, winner
-def make_move(args, game):
-  move = run_process(args, game + "\n\n")
+def make_move(args, game, engine=None):
+  if engine is not None:
+    move = engine.get_move(game)
+  else:
+    move = run_process(args, game + "\n\n")
   judge_result = run_process(["./judge"], game + "\n\n" + move)
+  if judge_result.strip() == "":
+    sys.exit("illegal move:\n" + move)
   judge_result_split = judge_result.strip().split("\n\n")
   new_game = judge_result_split[0].strip()
   winner = int(judge_result_split[1].strip()) if len(judge_result_split) > 1 else None
@@ -21,6 +57,12 @@ if __name__ == "__main__":
   parser = argparse.ArgumentParser(prog="play_game")
   parser.add_argument("initial_game", type=argparse.FileType("r"),
       help="Initial game state")
+  parser.add_argument("--engine", action="store_true",
+      help="Play with one persistent ./engine instead of ./main per move")
+  parser.add_argument("--movetime", type=int, default=1000,
+      help="Engine milliseconds per move")
+  parser.add_argument("--ponder", action="store_true",
+      help="Let the engine search on between moves")
 
   options = parser.parse_args(sys.argv[1:])
 
@@ -29,13 +71,17 @@ if __name__ == "__main__":
 
   # run game to completion!
 
+  engine = Engine(["./engine"], options.movetime, options.ponder) \
+      if options.engine else None
   game, winner = init_game, None
   while winner is None:
-    move, game, winner = make_move(["./main"], game)
+    move, game, winner = make_move(["./main"], game, engine)
 
     print(move.strip())
     print("---")
     print(game.strip())
     print("---")
 
+  if engine is not None:
+    engine.quit()
   print("Player {} wins!".format(winner))
@@ -0,0 +1,17 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <vector>
+
+#include "game.h"
+
+// Common interface of the fixed-depth search engines.
+class Search {
+  public:
+    virtual ~Search() {}
+
+    // Best turn for the current player, searching depth turns ahead
+    virtual std::vector<Action> get_actions(int depth) = 0;
+};
+
+#endif
@@ -0,0 +1,378 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "evaluator.h"
+#include "game.h"
+#include "game_io.h"
+#include "mcts.h"
+#include "negamax.h"
+#include "nnue.h"
+#include "opening_book.h"
+#include "position_history.h"
+#include "tablebase.h"
+
+// Plays two engine configurations against each other on a thread pool and
+// reports the result for A as a score, an Elo difference with a 95%
+// confidence interval, and optionally a sequential probability ratio test
+// that stops the match once one hypothesis is accepted.
+//
+// A configuration is a comma separated list of depth=N, mcts=playouts,
+// weights=file, network=file, book=file and tablebase=file, e.g.
+// "depth=2,weights=weights.txt". Openings may stop before the homeworlds are
+// set up; the book is used for setups and search for the rest. Negamax
+// probes the endgame tablebase. Every opening is played twice with A moving
+// first and second. Games that last longer than the turn limit are draws,
+// and so are games reaching the same position at the start of a turn for
+// the given number of times (0 to never stop). Negamax scores any
+// repetition of an earlier position as a draw.
+//
+// Each game record is a line "game <n> A <player> result <winner> turns <t>"
+// (winner 0 for a draw, including a tie where both homeworlds fall
+// together), the opening as printed by print_game, and the
+// actions of every turn followed by a blank line.
+//
+// Usage: ./selfplay <openings> [-a config] [-b config] [-g games]
+//                   [-t threads] [-m max turns] [-r repetitions]
+//                   [-o record file] [--sprt elo0 elo1]
+
+const static double SPRT_ALPHA = 0.05;
+const static double SPRT_BETA = 0.05;
+const static int REPORT_INTERVAL = 10;
+
+struct Config {
+  int depth = 2;
+  int playouts = 0; // MCTS instead of negamax when non-zero
+  Evaluator evaluator;
+  NnueNetwork *network = nullptr;
+  OpeningBook *book = nullptr;
+  Tablebase *tablebase = nullptr;
+};
+
+struct Opening {
+  Game *game;
+  std::map<int, std::string> system_names;
+};
+
+struct Match {
+  const std::vector<Opening> *openings;
+  const Config *configs[2]; // A, B
+  int games;
+  int max_turns;
+  int repetitions;
+  bool sprt;
+  double elo0, elo1;
+
+  std::atomic<int> next_game;
+  std::atomic<bool> stop;
+  std::mutex lock; // guards everything below
+  int wins, losses, draws;
+  std::ostream *records;
+};
+
+static bool parse_config(const std::string& text, Config& config) {
+  std::istringstream is(text);
+  std::string item;
+  while (std::getline(is, item, ',')) {
+    size_t eq = item.find('=');
+    std::string key = item.substr(0, eq);
+    std::string value = eq == std::string::npos ? "" : item.substr(eq + 1);
+    if (key == "depth") {
+      config.depth = std::max(1, std::atoi(value.c_str()));
+    } else if (key == "mcts") {
+      config.playouts = std::max(1, std::atoi(value.c_str()));
+    } else if (key == "weights") {
+      std::ifstream in(value);
+      if (!in || !config.evaluator.load(in)) {
+        std::cerr << "could not load weights from " << value << std::endl;
+        return false;
+      }
+    } else if (key == "network") {
+      std::ifstream in(value, std::ios::binary);
+      config.network = new NnueNetwork();
+      if (!config.network->load(in)) {
+        std::cerr << "could not load network from " << value << std::endl;
+        return false;
+      }
+    } else if (key == "book") {
+      config.book = new OpeningBook();
+      if (!config.book->open(value)) {
+        std::cerr << "could not read opening book from " << value << std::endl;
+        return false;
+      }
+    } else if (key == "tablebase") {
+      config.tablebase = new Tablebase();
+      if (!config.tablebase->open(value)) {
+        std::cerr << "could not read tablebase from " << value << std::endl;
+        return false;
+      }
+    } else {
+      std::cerr << "unknown configuration item " << item << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+static double elo(double score) {
+  score = std::min(std::max(score, 1e-6), 1.0 - 1e-6);
+  return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+static double expected_score(double elo) {
+  return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+// Mean and variance of the per game score
+static void score_stats(int wins, int losses, int draws, double *mean,
+                        double *variance) {
+  int n = wins + losses + draws;
+  *mean = (wins + 0.5 * draws) / n;
+  *variance = (wins * std::pow(1.0 - *mean, 2) +
+      draws * std::pow(0.5 - *mean, 2) + losses * std::pow(*mean, 2)) / n;
+}
+
+// Log likelihood ratio of elo1 against elo0, using the normal approximation
+static double sprt_llr(int wins, int losses, int draws, double elo0,
+                       double elo1) {
+  double mean, variance;
+  score_stats(wins, losses, draws, &mean, &variance);
+  if (variance <= 0) {
+    return 0;
+  }
+  double s0 = expected_score(elo0);
+  double s1 = expected_score(elo1);
+  int n = wins + losses + draws;
+  return n * (s1 - s0) * (2 * mean - s0 - s1) / (2 * variance);
+}
+
+static void report(std::ostream& os, const Match& match) {
+  int n = match.wins + match.losses + match.draws;
+  if (n == 0) {
+    return;
+  }
+  double mean, variance;
+  score_stats(match.wins, match.losses, match.draws, &mean, &variance);
+  double margin = 1.96 * std::sqrt(variance / n);
+  os << "games " << n << " wins " << match.wins << " losses " << match.losses
+    << " draws " << match.draws << " score " << mean << " elo " << elo(mean)
+    << " [" << elo(mean - margin) << ", " << elo(mean + margin) << "]";
+  if (match.sprt) {
+    double llr = sprt_llr(match.wins, match.losses, match.draws,
+        match.elo0, match.elo1);
+    double lower = std::log(SPRT_BETA / (1 - SPRT_ALPHA));
+    double upper = std::log((1 - SPRT_BETA) / SPRT_ALPHA);
+    os << " llr " << llr << " [" << lower << ", " << upper << "]";
+    if (llr <= lower) {
+      os << " H0";
+    } else if (llr >= upper) {
+      os << " H1";
+    }
+  }
+  os << std::endl;
+}
+
+static std::vector<Action> choose_actions(Game& game, const Config& config,
+                                          Negamax& negamax) {
+  Action setup;
+  if (config.book != nullptr && config.book->lookup(game, setup)) {
+    return {setup, Action{game.cur_player(), PASS}};
+  }
+  if (config.playouts > 0) {
+    Mcts mcts(&game, 1);
+    return mcts.get_actions(config.playouts);
+  }
+  std::vector<Action> actions;
+  negamax.set_root(&game);
+  for (int depth = 1; depth <= config.depth; depth++) {
+    actions = negamax.get_actions(depth);
+  }
+  return actions;
+}
+
+// Returns the winner, or 0 for a draw or a tie, and appends the turns to
+// record
+static int play_game(const Opening& opening, const Config *configs[3],
+                     int max_turns, int repetitions, std::ostream& record,
+                     int *turns) {
+  Game game(*opening.game);
+  std::map<int, std::string> system_names(opening.system_names);
+  Negamax *searches[3] = {nullptr};
+  for (int player = 1; player <= 2; player++) {
+    searches[player] = new Negamax(&game, configs[player]->evaluator);
+    searches[player]->set_tablebase(configs[player]->tablebase);
+  }
+
+  PositionHistory history;
+  for (*turns = 0; *turns < max_turns && game.winner() == 0; (*turns)++) {
+    if (repetitions > 0 && history.count(game.key()) + 1 >= repetitions) {
+      break;
+    }
+    const Config& config = *configs[game.cur_player()];
+    game.set_network(config.network);
+    searches[game.cur_player()]->set_history(history);
+    history.push(game.key());
+    std::vector<Action> actions =
+      choose_actions(game, config, *searches[game.cur_player()]);
+    print_turn(record, game, actions, system_names);
+    record << std::endl;
+  }
+
+  delete searches[1];
+  delete searches[2];
+  return std::max(game.winner(), 0);
+}
+
+static void worker(Match *match) {
+  while (!match->stop) {
+    int index = match->next_game++;
+    if (index >= match->games) {
+      break;
+    }
+    const Opening& opening =
+      (*match->openings)[(index / 2) % match->openings->size()];
+    int a_player = index % 2 == 0 ? 1 : 2;
+    const Config *configs[3] = {nullptr};
+    configs[a_player] = match->configs[0];
+    configs[3 - a_player] = match->configs[1];
+
+    std::ostringstream turns_record;
+    int turns;
+    int winner = play_game(opening, configs, match->max_turns,
+        match->repetitions, turns_record, &turns);
+
+    std::lock_guard<std::mutex> lock(match->lock);
+    if (winner == a_player) {
+      match->wins++;
+    } else if (winner == 0) {
+      match->draws++;
+    } else {
+      match->losses++;
+    }
+    if (match->records != nullptr) {
+      *match->records << "game " << index << " A " << a_player
+        << " result " << winner << " turns " << turns << std::endl;
+      print_game(*match->records, *opening.game, opening.system_names);
+      *match->records << turns_record.str();
+    }
+
+    int n = match->wins + match->losses + match->draws;
+    if (n % REPORT_INTERVAL == 0) {
+      report(std::cerr, *match);
+    }
+    if (match->sprt) {
+      double llr = sprt_llr(match->wins, match->losses, match->draws,
+          match->elo0, match->elo1);
+      if (llr <= std::log(SPRT_BETA / (1 - SPRT_ALPHA)) ||
+          llr >= std::log((1 - SPRT_BETA) / SPRT_ALPHA)) {
+        match->stop = true;
+      }
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "usage: ./selfplay <openings> [-a config] [-b config] "
+      "[-g games] [-t threads] [-m max turns] [-r repetitions] "
+      "[-o record file] [--sprt elo0 elo1]" << std::endl;
+    return 1;
+  }
+
+  Config configs[2];
+  Match match;
+  match.games = 100;
+  match.max_turns = 200;
+  match.repetitions = 3;
+  match.sprt = false;
+  match.elo0 = match.elo1 = 0;
+  match.records = nullptr;
+  int num_threads = std::thread::hardware_concurrency();
+  std::ofstream records;
+  for (int i = 2; i < argc; i++) {
+    std::string arg = argv[i];
+    if ((arg == "-a" || arg == "-b") && i + 1 < argc) {
+      if (!parse_config(argv[++i], configs[arg == "-a" ? 0 : 1])) {
+        return 1;
+      }
+    } else if (arg == "-g" && i + 1 < argc) {
+      match.games = std::atoi(argv[++i]);
+    } else if (arg == "-t" && i + 1 < argc) {
+      num_threads = std::atoi(argv[++i]);
+    } else if (arg == "-m" && i + 1 < argc) {
+      match.max_turns = std::atoi(argv[++i]);
+    } else if (arg == "-r" && i + 1 < argc) {
+      match.repetitions = std::atoi(argv[++i]);
+    } else if (arg == "-o" && i + 1 < argc) {
+      records.open(argv[++i]);
+      match.records = &records;
+    } else if (arg == "--sprt" && i + 2 < argc) {
+      match.sprt = true;
+      match.elo0 = std::atof(argv[++i]);
+      match.elo1 = std::atof(argv[++i]);
+    } else {
+      std::cerr << "unknown argument " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (num_threads < 1) {
+    num_threads = 1;
+  }
+
+  std::ifstream in(argv[1]);
+  if (!in) {
+    std::cerr << "could not open " << argv[1] << std::endl;
+    return 1;
+  }
+  std::vector<Opening> openings;
+  while (in >> std::ws && !in.eof()) {
+    Opening opening;
+    opening.game = read_game(in, opening.system_names);
+    if (opening.game == nullptr) {
+      std::cerr << "skipping a malformed opening" << std::endl;
+      continue;
+    }
+    if (opening.game->num_players() != 2) {
+      std::cerr << "skipping an opening without two players" << std::endl;
+      delete opening.game;
+      continue;
+    }
+    openings.push_back(opening);
+  }
+  if (openings.empty()) {
+    std::cerr << "no openings in " << argv[1] << std::endl;
+    return 1;
+  }
+
+  match.openings = &openings;
+  match.configs[0] = &configs[0];
+  match.configs[1] = &configs[1];
+  match.next_game = 0;
+  match.stop = false;
+  match.wins = match.losses = match.draws = 0;
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.push_back(std::thread(worker, &match));
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  report(std::cout, match);
+
+  for (Opening& opening : openings) {
+    delete opening.game;
+  }
+  delete configs[0].network;
+  delete configs[1].network;
+  delete configs[0].book;
+  delete configs[1].book;
+  delete configs[0].tablebase;
+  delete configs[1].tablebase;
+}
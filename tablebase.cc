@@ -0,0 +1,446 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "tablebase.h"
+#include "turn.h"
+
+const static int HEADER_SIZE = 20;
+const static int INDEX_ENTRY_SIZE = 36;
+const static int KEY_BYTES = 32;
+const static int PYRAMIDS = 12;
+
+struct Layout {
+  std::vector<Pyramid> homes[2];
+  std::vector<Pyramid> stars; // of the other systems, one each
+  std::vector<std::pair<Ship, int>> ships; // 0, 1 homes, then other systems
+};
+
+static void write_u32(std::ostream& os, unsigned int value) {
+  for (int i = 0; i < 4; i++) {
+    os.put((char)(value >> (8 * i)));
+  }
+}
+
+static void write_varint(std::ostream& os, unsigned int value) {
+  while (value >= 0x80) {
+    os.put((char)(value | 0x80));
+    value >>= 7;
+  }
+  os.put((char)value);
+}
+
+static unsigned long long read_bytes(const unsigned char *p, int n) {
+  unsigned long long value = 0;
+  for (int i = n - 1; i >= 0; i--) {
+    value = value << 8 | p[i];
+  }
+  return value;
+}
+
+static unsigned int read_varint(const unsigned char *& p) {
+  unsigned int value = 0;
+  for (int shift = 0; ; shift += 7) {
+    unsigned char byte = *p++;
+    value |= (unsigned int)(byte & 0x7f) << shift;
+    if (byte < 0x80) {
+      return value;
+    }
+  }
+}
+
+static void key_bytes(const PositionKey& key, unsigned char bytes[KEY_BYTES]) {
+  for (int i = 0; i < KEY_BYTES; i++) {
+    bytes[i] = key.words[i / 8] >> (56 - 8 * (i % 8));
+  }
+}
+
+static int encode_turns(int turns) {
+  return turns > 0 ? turns * 2 : -turns * 2 + 1;
+}
+
+static int decode_turns(unsigned int value) {
+  return value & 1 ? -(int)(value >> 1) : value >> 1;
+}
+
+void write_tablebase(std::ostream& os, int max_ships,
+                     std::vector<TablebaseEntry> entries) {
+  std::sort(entries.begin(), entries.end(),
+      [](const TablebaseEntry& a, const TablebaseEntry& b) {
+        return a.key < b.key;
+      });
+  size_t blocks = (entries.size() + TABLEBASE_BLOCK - 1) / TABLEBASE_BLOCK;
+
+  // Blocks are built first for their offsets
+  std::vector<unsigned int> offsets;
+  std::ostringstream body;
+  unsigned char previous[KEY_BYTES], current[KEY_BYTES];
+  for (size_t i = 0; i < entries.size(); i++) {
+    key_bytes(entries[i].key, current);
+    if (i % TABLEBASE_BLOCK == 0) {
+      offsets.push_back(body.tellp());
+    } else {
+      int shared = 0;
+      while (shared < KEY_BYTES && current[shared] == previous[shared]) {
+        shared++;
+      }
+      body.put((char)shared);
+      body.write((const char*)current + shared, KEY_BYTES - shared);
+    }
+    write_varint(body, encode_turns(entries[i].turns));
+    std::memcpy(previous, current, KEY_BYTES);
+  }
+
+  os.write("HWTB", 4);
+  write_u32(os, TABLEBASE_VERSION);
+  write_u32(os, max_ships);
+  write_u32(os, entries.size());
+  write_u32(os, blocks);
+  for (size_t b = 0; b < blocks; b++) {
+    const PositionKey& first = entries[b * TABLEBASE_BLOCK].key;
+    for (int i = 0; i < 4; i++) {
+      write_u32(os, first.words[i]);
+      write_u32(os, first.words[i] >> 32);
+    }
+    write_u32(os, offsets[b]);
+  }
+  os << body.str();
+  os.flush();
+}
+
+int ships_in_play(const Game& game) {
+  int ships = 0;
+  for (int player = 1; player <= game.num_players(); player++) {
+    ships += game.ship_count(player, SMALL) + game.ship_count(player, MEDIUM) +
+      game.ship_count(player, LARGE);
+  }
+  return ships;
+}
+
+Tablebase::Tablebase() :
+    data(nullptr), bytes(0), count(0), blocks(0), ships(0) {}
+
+Tablebase::~Tablebase() {
+  if (data != nullptr) {
+    munmap((void*)data, bytes);
+  }
+}
+
+bool Tablebase::open(const std::string& filename) {
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < HEADER_SIZE) {
+    close(fd);
+    return false;
+  }
+  void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+  const unsigned char *p = (const unsigned char*)mapped;
+  count = read_bytes(p + 12, 4);
+  blocks = read_bytes(p + 16, 4);
+  size_t index_end = HEADER_SIZE + blocks * INDEX_ENTRY_SIZE;
+  if (std::memcmp(p, "HWTB", 4) != 0 ||
+      read_bytes(p + 4, 4) != TABLEBASE_VERSION ||
+      blocks != (count + TABLEBASE_BLOCK - 1) / TABLEBASE_BLOCK ||
+      index_end > (size_t)st.st_size) {
+    munmap(mapped, st.st_size);
+    count = blocks = 0;
+    return false;
+  }
+  data = p;
+  bytes = st.st_size;
+  ships = read_bytes(p + 8, 4);
+  return true;
+}
+
+size_t Tablebase::size() const {
+  return count;
+}
+
+int Tablebase::max_ships() const {
+  return ships;
+}
+
+bool Tablebase::probe(const Game& game, int& turns) const {
+  if (count == 0 || game.num_players() != 2 || ships_in_play(game) > ships) {
+    return false;
+  }
+  return probe(encode_position(game), turns);
+}
+
+bool Tablebase::probe(const PositionKey& key, int& turns) const {
+  // The last block starting at or before key
+  const unsigned char *index = data + HEADER_SIZE;
+  PositionKey first;
+  size_t low = 0, high = blocks;
+  while (low < high) {
+    size_t mid = (low + high) / 2;
+    for (int w = 0; w < 4; w++) {
+      first.words[w] = read_bytes(index + mid * INDEX_ENTRY_SIZE + 8 * w, 8);
+    }
+    if (key < first) {
+      high = mid;
+    } else {
+      low = mid + 1;
+    }
+  }
+  if (low == 0) {
+    return false;
+  }
+  size_t block = low - 1;
+  const unsigned char *entry = index + block * INDEX_ENTRY_SIZE;
+  for (int w = 0; w < 4; w++) {
+    first.words[w] = read_bytes(entry + 8 * w, 8);
+  }
+
+  unsigned char target[KEY_BYTES], current[KEY_BYTES];
+  key_bytes(key, target);
+  key_bytes(first, current);
+  const unsigned char *blocks_start = index + blocks * INDEX_ENTRY_SIZE;
+  const unsigned char *p = blocks_start + read_bytes(entry + 32, 4);
+  const unsigned char *end = data + bytes;
+  size_t entries = std::min((size_t)TABLEBASE_BLOCK,
+      count - block * TABLEBASE_BLOCK);
+  for (size_t i = 0; i < entries && p < end; i++) {
+    if (i > 0) {
+      int shared = std::min((int)*p++, KEY_BYTES);
+      if (p + KEY_BYTES - shared > end) {
+        return false;
+      }
+      std::memcpy(current + shared, p, KEY_BYTES - shared);
+      p += KEY_BYTES - shared;
+    }
+    unsigned int value = read_varint(p);
+    int order = std::memcmp(current, target, KEY_BYTES);
+    if (order == 0) {
+      turns = decode_turns(value);
+      return true;
+    } else if (order > 0) {
+      return false;
+    }
+  }
+  return false;
+}
+
+static Pyramid pyramid(int code) {
+  return Pyramid{(Size)(code / 4 + 1), (Colour)(code % 4)};
+}
+
+static int code(const Pyramid& pyramid) {
+  return (pyramid.size - 1) * 4 + pyramid.colour;
+}
+
+static bool home_ship(const Layout& layout, int player) {
+  for (const auto& ship : layout.ships) {
+    if (ship.first.player == player && ship.second == player - 1) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Adds the keys of the layout for both players to move
+static void add_layout(const Layout& layout, std::vector<PositionKey>& keys) {
+  Game game(2);
+  std::vector<int> ids;
+  ids.push_back(game.create_system(layout.homes[0], 1));
+  ids.push_back(game.create_system(layout.homes[1], 2));
+  for (const Pyramid& star : layout.stars) {
+    ids.push_back(game.create_system({star}));
+  }
+  for (const auto& ship : layout.ships) {
+    game.add_ship(ids[ship.second], ship.first);
+  }
+  for (int player = 1; player <= 2; player++) {
+    game.set_cur_player(player);
+    keys.push_back(encode_position(game));
+  }
+}
+
+// Places up to remaining ships of player and then of the next, in
+// increasing pyramid order, at the homes, the other systems or a new
+// system. Every player keeps a ship at home.
+static void place_ships(Layout& layout, int player, int count, int min_code,
+                        int used[PYRAMIDS], int remaining,
+                        std::vector<PositionKey>& keys) {
+  if (count > 0 && home_ship(layout, player)) {
+    if (player == 2) {
+      add_layout(layout, keys);
+    } else {
+      place_ships(layout, 2, 0, 0, used, remaining, keys);
+    }
+  }
+  if (remaining <= (player == 1 ? 1 : 0)) {
+    return; // the second player needs a ship
+  }
+  for (int c = min_code; c < PYRAMIDS; c++) {
+    if (used[c] == 3) {
+      continue;
+    }
+    used[c]++;
+    Ship ship = Ship{player, pyramid(c)};
+    int locations = 2 + layout.stars.size();
+    for (int location = 0; location < locations; location++) {
+      layout.ships.push_back(std::make_pair(ship, location));
+      place_ships(layout, player, count + 1, c, used, remaining - 1, keys);
+      layout.ships.pop_back();
+    }
+    for (int star = 0; star < PYRAMIDS; star++) {
+      if (used[star] == 3) {
+        continue;
+      }
+      used[star]++;
+      layout.stars.push_back(pyramid(star));
+      layout.ships.push_back(std::make_pair(ship, locations));
+      place_ships(layout, player, count + 1, c, used, remaining - 1, keys);
+      layout.ships.pop_back();
+      layout.stars.pop_back();
+      used[star]--;
+    }
+    used[c]--;
+  }
+}
+
+// Homeworld stars, and what catastrophes can leave of them
+static std::vector<std::vector<Pyramid>> home_variants(
+    const std::vector<Pyramid>& stars) {
+  std::vector<std::vector<Pyramid>> variants({stars});
+  if (stars.size() == 2) {
+    variants.push_back({stars[0]});
+    variants.push_back({stars[1]});
+  }
+  return variants;
+}
+
+std::vector<PositionKey> enumerate_endgame(const std::vector<Game*>& games,
+                                           int max_ships) {
+  std::vector<PositionKey> keys;
+  for (const Game *game : games) {
+    std::vector<Pyramid> homes[2];
+    for (const System& system : game->systems()) {
+      if (system.player != 0) {
+        homes[system.player - 1] = system.stars;
+      }
+    }
+    for (const auto& first : home_variants(homes[0])) {
+      for (const auto& second : home_variants(homes[1])) {
+        Layout layout;
+        layout.homes[0] = first;
+        layout.homes[1] = second;
+        int used[PYRAMIDS] = {0};
+        for (const Pyramid& star : first) {
+          used[code(star)]++;
+        }
+        for (const Pyramid& star : second) {
+          used[code(star)]++;
+        }
+        place_ships(layout, 1, 0, 0, used, max_ships, keys);
+      }
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  return keys;
+}
+
+TablebaseNode generate_node(const std::vector<PositionKey>& keys, size_t index,
+                            int max_ships) {
+  TablebaseNode node = TablebaseNode{false, false};
+  Game *game = decode_position(keys[index]);
+  int player = game->cur_player();
+  for (Turn *turn : get_turns(game)) {
+    const Game& next = *turn->game;
+    int winner = next.winner();
+    if (winner == player) {
+      node.win_now = true;
+    } else if (winner == 3 - player) {
+      // A losing turn never helps
+    } else if (winner != 0 || ships_in_play(next) > max_ships) {
+      node.escape = true;
+    } else {
+      auto it = std::lower_bound(keys.begin(), keys.end(),
+          encode_position(next));
+      if (it != keys.end() && *it == encode_position(next)) {
+        node.successors.push_back(it - keys.begin());
+      } else {
+        node.escape = true;
+      }
+    }
+    delete turn;
+  }
+  delete game;
+  if (node.win_now) {
+    node.successors.clear();
+  }
+  return node;
+}
+
+std::vector<int> retrograde(const std::vector<TablebaseNode>& nodes) {
+  size_t n = nodes.size();
+  std::vector<size_t> starts(n + 1, 0);
+  for (const TablebaseNode& node : nodes) {
+    for (unsigned int successor : node.successors) {
+      starts[successor + 1]++;
+    }
+  }
+  for (size_t i = 0; i < n; i++) {
+    starts[i + 1] += starts[i];
+  }
+  std::vector<unsigned int> predecessors(starts[n]);
+  std::vector<size_t> fill(starts.begin(), starts.end() - 1);
+  for (size_t i = 0; i < n; i++) {
+    for (unsigned int successor : nodes[i].successors) {
+      predecessors[fill[successor]++] = i;
+    }
+  }
+
+  std::vector<int> turns(n, 0);
+  std::vector<int> pending(n, -1); // successors not yet won, -1 if escaping
+  std::deque<unsigned int> queue;
+  for (size_t i = 0; i < n; i++) {
+    if (nodes[i].win_now) {
+      turns[i] = 1;
+      queue.push_back(i);
+    } else if (!nodes[i].escape) {
+      pending[i] = nodes[i].successors.size();
+      if (pending[i] == 0) {
+        turns[i] = -1; // every turn loses at once
+        queue.push_back(i);
+      }
+    }
+  }
+
+  // Positions leave the queue in increasing distance
+  while (!queue.empty()) {
+    unsigned int child = queue.front();
+    queue.pop_front();
+    int distance = std::abs(turns[child]) + 1;
+    for (size_t p = starts[child]; p < starts[child + 1]; p++) {
+      unsigned int parent = predecessors[p];
+      if (turns[parent] != 0) {
+        continue;
+      }
+      if (turns[child] < 0) {
+        turns[parent] = distance;
+        queue.push_back(parent);
+      } else if (pending[parent] > 0 && --pending[parent] == 0) {
+        turns[parent] = -distance;
+        queue.push_back(parent);
+      }
+    }
+  }
+  return turns;
+}
@@ -0,0 +1,88 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "game.h"
+#include "position_key.h"
+
+// Exact results of two player positions with few ships in play, as computed
+// by ./endgame. All integers are little endian.
+//
+//   header  "HWTB", u32 version, u32 most ships in play, u32 entry
+//           count, u32 block count
+//   index   per block, its first key (4 u64 words) and the u32 offset of
+//           the block from the end of the index
+//   blocks  up to TABLEBASE_BLOCK entries in increasing key order. Every
+//           entry but the first of a block starts with a u8 count of key
+//           bytes shared with the previous entry, followed by the rest of
+//           the key. Keys are written as their words in order, most
+//           significant byte first, so byte order is key order. Then comes
+//           the result as a varint, turns * 2 + 1 if the player to move
+//           loses.
+//
+// Positions without a proven win or loss are left out.
+
+const static unsigned int TABLEBASE_VERSION = 1;
+const static int TABLEBASE_BLOCK = 64;
+
+struct TablebaseEntry {
+  PositionKey key;
+  int turns; // until the player to move wins, negated if they lose
+};
+
+// Sorts entries and writes them as a table
+void write_tablebase(std::ostream& os, int max_ships,
+                     std::vector<TablebaseEntry> entries);
+
+// Ships of all players in game
+int ships_in_play(const Game& game);
+
+// Generation, as run by ./endgame
+
+// Turns of one position
+struct TablebaseNode {
+  bool win_now; // some turn wins at once, so successors are not kept
+  bool escape; // some turn leaves the table
+  std::vector<unsigned int> successors; // indices into the keys
+};
+
+// Sorted keys of every position with the homeworlds of games, or what
+// catastrophes can leave of them, and at most max_ships ships in play, each
+// player keeping a ship at home
+std::vector<PositionKey> enumerate_endgame(const std::vector<Game*>& games,
+                                           int max_ships);
+// Generates the turns of keys[index]
+TablebaseNode generate_node(const std::vector<PositionKey>& keys, size_t index,
+                            int max_ships);
+// Turns until the player to move wins, negated if they lose, or 0. A node
+// that may escape the table is never lost.
+std::vector<int> retrograde(const std::vector<TablebaseNode>& nodes);
+
+// Memory-mapped reader
+class Tablebase {
+  public:
+    Tablebase();
+    ~Tablebase();
+
+    bool open(const std::string& filename); // false if missing or malformed
+    size_t size() const;
+    int max_ships() const; // in play
+
+    // Turns until the player to move wins, negated if they lose. False if
+    // the position has no proven result, including any position with more
+    // ships than the table covers.
+    bool probe(const Game& game, int& turns) const;
+    bool probe(const PositionKey& key, int& turns) const;
+
+  private:
+    const unsigned char *data;
+    size_t bytes;
+    size_t count;
+    size_t blocks;
+    int ships;
+};
+
+#endif
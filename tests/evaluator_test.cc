@@ -0,0 +1,60 @@
+#include <sstream>
+
+#include "../evaluator.h"
+#include "../game.h"
+#include "catch.hpp"
+
+TEST_CASE("evaluation features and weights") {
+  Game g = Game(2);
+
+  int home1 = g.create_system({Pyramid{SMALL, BLUE}, Pyramid{MEDIUM, YELLOW}}, 1);
+  g.add_ship(home1, Ship{1, Pyramid{LARGE, GREEN}});
+  int home2 = g.create_system({Pyramid{LARGE, RED}, Pyramid{LARGE, GREEN}}, 2);
+  g.add_ship(home2, Ship{2, Pyramid{MEDIUM, YELLOW}});
+  g.add_ship(home2, Ship{1, Pyramid{SMALL, BLUE}});
+
+  Evaluator evaluator;
+  int values[NUM_FEATURES];
+
+  SECTION("features are computed from the position") {
+    evaluator.features(&g, 2, values);
+
+    REQUIRE(values[MEDIUM_SHIPS] == 1);
+    REQUIRE(values[HOME_COLOURS] == 3);
+    REQUIRE(values[HOME_STAR_SIZES] == 1);
+    REQUIRE(values[HOME_STAR_COLOURS] == 2);
+    REQUIRE(values[ATTACKABLE_SHIPS] == 0);
+    REQUIRE(values[HOME_INVADERS] == 0);
+
+    evaluator.features(&g, 1, values);
+
+    REQUIRE(values[SMALL_SHIPS] == 1);
+    REQUIRE(values[LARGE_SHIPS] == 1);
+    REQUIRE(values[FLEET_COLOURS] == 2);
+    REQUIRE(values[ATTACKABLE_SHIPS] == 1);
+  }
+
+  SECTION("weights are read from and written to weight files") {
+    std::istringstream is("# material only\nlarge_ships 7\nsmall_ships 1\n");
+    REQUIRE(evaluator.load(is));
+
+    REQUIRE(evaluator.weight(LARGE_SHIPS) == 7);
+    REQUIRE(evaluator.weight(SMALL_SHIPS) == 1);
+    REQUIRE(evaluator.weight(MEDIUM_SHIPS) == 400);
+
+    std::ostringstream os;
+    evaluator.save(os);
+    Evaluator copy;
+    std::istringstream saved(os.str());
+    REQUIRE(copy.load(saved));
+    for (int feature = 0; feature < NUM_FEATURES; feature++) {
+      REQUIRE(copy.weight((Feature)feature) == evaluator.weight((Feature)feature));
+    }
+  }
+
+  SECTION("unknown feature names are rejected") {
+    std::istringstream is("no_such_feature 3\n");
+
+    REQUIRE(!evaluator.load(is));
+  }
+}
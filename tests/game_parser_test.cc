@@ -0,0 +1,142 @@
+#include <cctype>
+#include <sstream>
+
+#include "../game.h"
+#include "../game_io.h"
+#include "../game_parser.h"
+#include "../playout.h"
+#include "catch.hpp"
+
+TEST_CASE("the game parser agrees with read_game and read_action") {
+  Game initial = Game(2);
+  int home1 = initial.create_system({Pyramid{SMALL, BLUE},
+      Pyramid{MEDIUM, YELLOW}}, 1);
+  int home2 = initial.create_system({Pyramid{LARGE, GREEN},
+      Pyramid{MEDIUM, YELLOW}}, 2);
+  initial.add_ship(home1, Ship{1, Pyramid{LARGE, GREEN}});
+  initial.add_ship(home1, Ship{1, Pyramid{SMALL, RED}});
+  initial.add_ship(home2, Ship{2, Pyramid{LARGE, BLUE}});
+  initial.add_ship(home2, Ship{2, Pyramid{SMALL, GREEN}});
+  initial.set_homeworlds_built(2);
+
+  // A few games, each a position followed by its turns
+  std::ostringstream os;
+  Rng rng(5);
+  for (int i = 0; i < 3; i++) {
+    std::map<int, std::string> names = {{home1, "Home1"}, {home2, "Home2"}};
+    Game g = initial;
+    os << i << std::endl;
+    print_game(os, g, names);
+    for (int turn = 0; turn < 30 && g.winner() == 0; turn++) {
+      std::vector<Action> trace;
+      Game before = g;
+      random_turn(g, rng, UNIFORM_POLICY, &trace);
+      print_turn(os, before, trace, names);
+    }
+    os << std::endl;
+  }
+  const std::string text = os.str();
+
+  std::istringstream is(text);
+  GameParser parser(text.data(), text.data() + text.size());
+  int number, parsed_number;
+  while (is >> number) {
+    REQUIRE(parser.read_int(parsed_number));
+    REQUIRE(parsed_number == number);
+
+    std::map<int, std::string> names, parsed_names;
+    Game *g = read_game(is, names);
+    Game *parsed = parser.read_game(&parsed_names);
+    REQUIRE(parsed->hash_string() == g->hash_string());
+    REQUIRE(parsed->key() == g->key());
+    REQUIRE(parsed_names == names);
+
+    while (is >> std::ws && std::isupper(is.peek())) {
+      Action action = Action(), parsed_action = Action();
+      action.player = parsed_action.player = g->cur_player();
+      std::string name = read_action(is, action, names);
+      NameRef parsed_name = parser.read_action(parsed_action);
+      REQUIRE((parsed_action == action));
+      REQUIRE(parsed_name.str() == name);
+      g->perform_action(action);
+      if (action.type == DISCOVER || action.type == HOMEWORLD) {
+        names.emplace(action.system_target, name);
+        parser.add_name(action.system_target, parsed_name);
+      }
+    }
+    delete g;
+    delete parsed;
+  }
+  REQUIRE(parser.done());
+}
+
+TEST_CASE("the game parser handles three players and catastrophes") {
+  const std::string text =
+    "3 3 2\n"
+    "Alpha (1, b1 y2) 1g3 1r1\n"
+    "Beta (2, r3 g1) 2y3 3b2\n"
+    "Gamma (3, y1 b3) 3g3\n"
+    "Delta (r2) 1r1 2r2 3r3 1r3\n"
+    "\n"
+    "CATASTROPHE Delta r\n"
+    "SACRIFICE g3 Gamma\n";
+
+  std::istringstream is(text);
+  std::map<int, std::string> names, parsed_names;
+  Game *g = read_game(is, names);
+  GameParser parser(text.data(), text.data() + text.size());
+  Game *parsed = parser.read_game(&parsed_names);
+  REQUIRE(parsed->num_players() == 3);
+  REQUIRE(parsed->cur_player() == 2);
+  REQUIRE(parsed->hash_string() == g->hash_string());
+  REQUIRE(parsed_names == names);
+
+  for (int i = 0; i < 2; i++) {
+    Action action = Action(), parsed_action = Action();
+    read_action(is, action, names);
+    parser.read_action(parsed_action);
+    REQUIRE((parsed_action == action));
+  }
+  REQUIRE(parser.done());
+  delete g;
+  delete parsed;
+}
+
+TEST_CASE("malformed games are rejected and skipped") {
+  const std::string text =
+    "2 2 1\n"
+    "Alpha (1, b1 y2) 9r1\n"
+    "\n"
+    "9 0 1\n"
+    "Beta (r2) 1g1\n"
+    "\n"
+    "2 2 1\n"
+    "Gamma (3, b1 y2) 1g3\n"
+    "\n"
+    "2 2 1\n"
+    "Delta (1, b1 y7) 1g3\n"
+    "\n"
+    "2 2 2\n"
+    "Alpha (1, b1 y2) 1g3\n"
+    "Beta (2, r3 g1) 2y3\n"
+    "\n";
+
+  std::istringstream is(text);
+  GameParser parser(text.data(), text.data() + text.size());
+  for (int i = 0; i < 4; i++) {
+    std::map<int, std::string> names;
+    REQUIRE(read_game(is, names) == nullptr);
+    REQUIRE(parser.read_game() == nullptr);
+  }
+
+  std::map<int, std::string> names;
+  Game *g = read_game(is, names);
+  Game *parsed = parser.read_game();
+  REQUIRE(g != nullptr);
+  REQUIRE(parsed != nullptr);
+  REQUIRE(g->cur_player() == 2);
+  REQUIRE(parsed->hash_string() == g->hash_string());
+  REQUIRE(parser.done());
+  delete g;
+  delete parsed;
+}
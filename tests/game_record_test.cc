@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#include "../game.h"
+#include "../game_record.h"
+#include "../playout.h"
+#include "catch.hpp"
+
+TEST_CASE("binary game records replay to the same positions") {
+  Game initial = Game(2);
+  int home1 = initial.create_system({Pyramid{SMALL, BLUE},
+      Pyramid{MEDIUM, YELLOW}}, 1);
+  int home2 = initial.create_system({Pyramid{LARGE, GREEN},
+      Pyramid{MEDIUM, YELLOW}}, 2);
+  initial.add_ship(home1, Ship{1, Pyramid{LARGE, GREEN}});
+  initial.add_ship(home1, Ship{1, Pyramid{SMALL, RED}});
+  initial.add_ship(home2, Ship{2, Pyramid{LARGE, BLUE}});
+  initial.add_ship(home2, Ship{2, Pyramid{SMALL, GREEN}});
+  initial.set_homeworlds_built(2);
+
+  std::vector<std::vector<Action> > games;
+  std::vector<unsigned long long> final_keys;
+  Rng rng(11);
+  for (int i = 0; i < 5; i++) {
+    Game g = initial;
+    std::vector<Action> actions;
+    for (int turn = 0; turn < 40 && g.winner() == 0; turn++) {
+      std::vector<Action> trace;
+      Game before = g;
+      random_turn(g, rng, UNIFORM_POLICY, &trace);
+      for (Action& action : trace) {
+        REQUIRE((unpack_action(pack_action(action, before), before) == action));
+        before.perform_action(action);
+      }
+      actions.insert(actions.end(), trace.begin(), trace.end());
+    }
+    games.push_back(actions);
+    final_keys.push_back(g.key());
+  }
+
+  const char *filename = "game_record_test.bin";
+  {
+    std::ofstream out(filename, std::ios::binary);
+    GameRecordWriter writer(out);
+    for (unsigned int i = 0; i < games.size(); i++) {
+      writer.add(initial, games[i], (int)(i % 4) - 1, 1); // -1 is a tie
+    }
+    writer.finish();
+  }
+
+  GameRecordReader reader;
+  REQUIRE(reader.open(filename));
+  REQUIRE(reader.num_games() == games.size());
+  for (unsigned int i = 0; i < games.size(); i++) {
+    REQUIRE(reader.winner(i) == std::max((int)(i % 4) - 1, 0));
+    REQUIRE(reader.label(i) == 1);
+    REQUIRE(reader.num_actions(i) == (int)games[i].size());
+
+    Game *g = reader.initial_game(i);
+    REQUIRE(g->key() == initial.key());
+    int n = 0;
+    reader.replay(i, [&games, &g, &n, i](const Game& game, const Action& action) {
+          REQUIRE(game.key() == g->key());
+          REQUIRE(action.type == games[i][n].type);
+          Action a = action;
+          g->perform_action(a);
+          n++;
+        });
+    REQUIRE(g->key() == final_keys[i]);
+    delete g;
+  }
+  std::remove(filename);
+}
+
+TEST_CASE("homeworld setups pack and unpack") {
+  Game g = Game(2);
+  Rng rng(2);
+  for (int turn = 0; turn < 2; turn++) {
+    std::vector<Action> trace;
+    Game before = g;
+    random_turn(g, rng, UNIFORM_POLICY, &trace);
+    REQUIRE(trace[0].type == HOMEWORLD);
+    for (Action& action : trace) {
+      REQUIRE((unpack_action(pack_action(action, before), before) == action));
+      before.perform_action(action);
+    }
+  }
+  REQUIRE(g.homeworlds_built() == 2);
+}
+
+TEST_CASE("corrupt game records are rejected") {
+  Game initial = Game(2);
+  int home1 = initial.create_system({Pyramid{SMALL, BLUE},
+      Pyramid{MEDIUM, YELLOW}}, 1);
+  int home2 = initial.create_system({Pyramid{LARGE, GREEN},
+      Pyramid{MEDIUM, YELLOW}}, 2);
+  initial.add_ship(home1, Ship{1, Pyramid{LARGE, GREEN}});
+  initial.add_ship(home2, Ship{2, Pyramid{LARGE, BLUE}});
+  initial.set_homeworlds_built(2);
+  std::vector<Action> actions;
+  actions.push_back(Action{1, BUILD, home1, Pyramid{SMALL, GREEN}});
+  actions.push_back(Action{1, PASS});
+
+  {
+    std::ofstream file("game_record_test.bin", std::ios::binary);
+    GameRecordWriter writer(file);
+    writer.add(initial, actions, 0);
+    writer.finish();
+  }
+  std::string good;
+  {
+    std::ifstream file("game_record_test.bin", std::ios::binary);
+    good.assign(std::istreambuf_iterator<char>(file),
+                std::istreambuf_iterator<char>());
+  }
+  // header, game header, then the first system: owner, stars, ships
+  const size_t game = 24, first_system = game + 10;
+  const size_t first_ship = first_system + 3 + 2;
+  auto open_with = [&good](size_t offset, unsigned char byte) {
+        std::string bad = good;
+        bad[offset] = (char)byte;
+        {
+          std::ofstream file("game_record_test.bin", std::ios::binary);
+          file << bad;
+        }
+        GameRecordReader reader;
+        return reader.open("game_record_test.bin");
+      };
+
+  REQUIRE(open_with(game, 2));
+  REQUIRE_FALSE(open_with(game, 0)); // players
+  REQUIRE_FALSE(open_with(game + 2, 3)); // player to move
+  REQUIRE_FALSE(open_with(game + 3, 3)); // winner
+  REQUIRE_FALSE(open_with(game + 6, 200)); // actions past the index
+  REQUIRE_FALSE(open_with(first_system + 1, 250)); // stars past the index
+  REQUIRE_FALSE(open_with(first_system, 3)); // owner
+  REQUIRE_FALSE(open_with(first_ship, 15 << 4 | 8)); // ship player
+  REQUIRE_FALSE(open_with(first_ship, 1 << 4 | 3)); // ship size
+  REQUIRE_FALSE(open_with(16, 200)); // index past the end
+  REQUIRE_FALSE(open_with(good.size() - 8, 200)); // game past the index
+  REQUIRE_FALSE(open_with(good.size() - 1, 1));
+
+  {
+    std::ofstream file("game_record_test.bin", std::ios::binary);
+    file << good.substr(0, good.size() - 8);
+  }
+  GameRecordReader truncated;
+  REQUIRE_FALSE(truncated.open("game_record_test.bin"));
+
+  // An illegal action is only found on replay: player 2 passes for player 1
+  std::string bad = good;
+  bad[good.size() - 8 - 4] = (char)(PASS | 2 << 3);
+  {
+    std::ofstream file("game_record_test.bin", std::ios::binary);
+    file << bad;
+  }
+  GameRecordReader reader;
+  REQUIRE(reader.open("game_record_test.bin"));
+  int n = 0;
+  REQUIRE_FALSE(reader.replay(0, [&n](const Game&, const Action&) { n++; }));
+  REQUIRE(n == 1);
+  std::remove("game_record_test.bin");
+}
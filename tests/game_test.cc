@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <iostream>
 
 #include "../game.h"
+#include "../playout.h"
 #include "catch.hpp"
 
 TEST_CASE("creating and destroying systems and ships affects the stash") {
@@ -209,6 +211,7 @@ TEST_CASE("computing winner") {
 
 TEST_CASE("generating all legal actions") {
   Game g = Game(2);
+  g.set_homeworlds_built(2); // past the setup phase
 
   int main_system = g.create_system(
       {Pyramid{SMALL, YELLOW}, Pyramid{MEDIUM, RED}});
@@ -305,6 +308,24 @@ TEST_CASE("generating all legal actions") {
   }
 }
 
+TEST_CASE("attacking captures the attacked ship") {
+  Game g = Game(2);
+  int main_system = g.create_system({Pyramid{LARGE, RED}});
+  g.add_ship(main_system, Ship{1, Pyramid{LARGE, GREEN}});
+  g.add_ship(main_system, Ship{2, Pyramid{MEDIUM, RED}});
+  g.add_ship(main_system, Ship{2, Pyramid{SMALL, YELLOW}});
+
+  Action attack{1, ATTACK, main_system, Pyramid{MEDIUM, RED}};
+  REQUIRE(g.perform_action(attack));
+
+  const System& system = g.get_system(main_system);
+  REQUIRE(std::count(system.ships.begin(), system.ships.end(),
+        Ship{1, Pyramid{MEDIUM, RED}}) == 1);
+  REQUIRE(std::count(system.ships.begin(), system.ships.end(),
+        Ship{2, Pyramid{SMALL, YELLOW}}) == 1);
+  REQUIRE(system.ships.size() == 3);
+}
+
 TEST_CASE("sanity checking getters and setters") {
   Game g = Game(2);
 
@@ -387,3 +408,258 @@ TEST_CASE("hash codes of equivalent Games should be equal") {
     }
   }
 }
+
+TEST_CASE("eliminated players are skipped in games with more than two players") {
+  Game g = Game(3);
+
+  int home1 = g.create_system({Pyramid{SMALL, BLUE}, Pyramid{MEDIUM, YELLOW}}, 1);
+  g.add_ship(home1, Ship{1, Pyramid{LARGE, GREEN}});
+  int home2 = g.create_system({Pyramid{SMALL, GREEN}, Pyramid{LARGE, YELLOW}}, 2);
+  g.add_ship(home2, Ship{1, Pyramid{LARGE, RED}});
+  int home3 = g.create_system({Pyramid{MEDIUM, RED}, Pyramid{LARGE, BLUE}}, 3);
+  g.add_ship(home3, Ship{3, Pyramid{LARGE, YELLOW}});
+
+  REQUIRE(g.winner() == 0);
+  REQUIRE(!g.eliminated(1));
+  REQUIRE(g.eliminated(2));
+  REQUIRE(!g.eliminated(3));
+
+  g.set_done_main_action(true);
+  Action pass{1, PASS};
+  g.perform_action(pass);
+
+  REQUIRE(g.cur_player() == 3);
+}
+
+TEST_CASE("material is maintained incrementally") {
+  Game g = Game(2);
+
+  int home1 = g.create_system({Pyramid{SMALL, BLUE}, Pyramid{MEDIUM, YELLOW}}, 1);
+  g.add_ship(home1, Ship{1, Pyramid{LARGE, GREEN}});
+  g.add_ship(home1, Ship{2, Pyramid{SMALL, GREEN}});
+  int colony = g.create_system({Pyramid{LARGE, GREEN}});
+  g.add_ship(colony, Ship{1, Pyramid{MEDIUM, GREEN}});
+  g.add_ship(colony, Ship{2, Pyramid{MEDIUM, BLUE}});
+
+  REQUIRE(g.material(1) == 13);
+  REQUIRE(g.material(2) == 5);
+  REQUIRE(g.ship_count(2, SMALL) == 1);
+
+  SECTION("removing a ship removes its material") {
+    g.remove_ship(colony, Ship{2, Pyramid{MEDIUM, BLUE}});
+
+    REQUIRE(g.material(2) == 1);
+  }
+
+  SECTION("catastrophes remove material") {
+    g.apply_catastrophe(home1, GREEN);
+
+    REQUIRE(g.material(1) == 4);
+    REQUIRE(g.material(2) == 4);
+  }
+
+  SECTION("destroying a system removes material") {
+    g.destroy_system(colony);
+
+    REQUIRE(g.material(1) == 9);
+    REQUIRE(g.material(2) == 1);
+  }
+}
+
+TEST_CASE("catastrophes in mixed systems remove only their colour") {
+  Game g = Game(2);
+  int home1 = g.create_system({Pyramid{SMALL, BLUE},
+      Pyramid{MEDIUM, YELLOW}}, 1);
+  g.add_ship(home1, Ship{1, Pyramid{LARGE, GREEN}});
+  int home2 = g.create_system({Pyramid{LARGE, YELLOW}}, 2);
+  g.add_ship(home2, Ship{2, Pyramid{SMALL, RED}});
+  g.add_ship(home2, Ship{1, Pyramid{SMALL, GREEN}});
+  int red = g.stash().at(Pyramid{SMALL, RED});
+  int green = g.stash().at(Pyramid{SMALL, GREEN});
+  REQUIRE(g.winner() == 0);
+
+  g.apply_catastrophe(home2, RED);
+
+  REQUIRE(g.stash().at(Pyramid{SMALL, RED}) == red + 1);
+  REQUIRE(g.stash().at(Pyramid{SMALL, GREEN}) == green);
+  REQUIRE(g.ship_count(2, SMALL) == 0);
+  REQUIRE(g.ship_count(1, SMALL) == 1);
+  REQUIRE(g.get_system(home2).ships.size() == 1);
+  REQUIRE(g.eliminated(2));
+  REQUIRE(g.winner() == 1);
+}
+
+TEST_CASE("position keys of equivalent Games should be equal") {
+  Game g1 = Game(2);
+  Game g2 = Game(2);
+
+  int g1s1 = g1.create_system({Pyramid{SMALL, BLUE}, Pyramid{LARGE, YELLOW}}, 1);
+  g1.create_system({Pyramid{MEDIUM, GREEN}}, 0);
+  int g2s2 = g2.create_system({Pyramid{MEDIUM, GREEN}}, 0);
+  int g2s1 = g2.create_system({Pyramid{SMALL, BLUE}, Pyramid{LARGE, YELLOW}}, 1);
+
+  REQUIRE(g1.key() == g2.key());
+
+  g1.add_ship(g1s1, Ship{1, Pyramid{LARGE, GREEN}});
+  g1.add_ship(g1s1, Ship{2, Pyramid{SMALL, YELLOW}});
+
+  REQUIRE(g1.key() != g2.key());
+
+  g2.add_ship(g2s1, Ship{2, Pyramid{SMALL, YELLOW}});
+  g2.add_ship(g2s1, Ship{1, Pyramid{LARGE, GREEN}});
+
+  REQUIRE(g1.key() == g2.key());
+
+  SECTION("the same ships in different systems give different keys") {
+    g2.remove_ship(g2s1, Ship{2, Pyramid{SMALL, YELLOW}});
+    g2.add_ship(g2s2, Ship{2, Pyramid{SMALL, YELLOW}});
+
+    REQUIRE(g1.key() != g2.key());
+  }
+
+  SECTION("whose turn it is is part of the key") {
+    g2.set_cur_player(2);
+
+    REQUIRE(g1.key() != g2.key());
+  }
+}
+
+TEST_CASE("adding a system takes its stars and ships from the stash") {
+  Game g = Game(2);
+  System system = System{0, 0, {Pyramid{SMALL, RED}}};
+  system.ships.push_back(Ship{1, Pyramid{SMALL, RED}});
+  system.ships.push_back(Ship{2, Pyramid{LARGE, BLUE}});
+  int id = g.add_system(system);
+
+  REQUIRE((g.stash().at(Pyramid{SMALL, RED}) == 1));
+  REQUIRE((g.stash().at(Pyramid{LARGE, BLUE}) == 2));
+
+  g.destroy_system(id);
+
+  REQUIRE((g.stash().at(Pyramid{SMALL, RED}) == 3));
+  REQUIRE((g.stash().at(Pyramid{LARGE, BLUE}) == 3));
+}
+
+TEST_CASE("validate_action accepts exactly the legal actions") {
+  Game initial = Game(2);
+  int home1 = initial.create_system({Pyramid{SMALL, BLUE},
+      Pyramid{MEDIUM, YELLOW}}, 1);
+  int home2 = initial.create_system({Pyramid{LARGE, GREEN},
+      Pyramid{MEDIUM, RED}}, 2);
+  initial.add_ship(home1, Ship{1, Pyramid{LARGE, GREEN}});
+  initial.add_ship(home2, Ship{2, Pyramid{LARGE, YELLOW}});
+
+  std::vector<Pyramid> pyramids;
+  for (Size size : {SMALL, MEDIUM, LARGE}) {
+    for (Colour colour : {RED, YELLOW, GREEN, BLUE}) {
+      pyramids.push_back(Pyramid{size, colour});
+    }
+  }
+
+  Rng rng(7);
+  int positions = 0;
+  for (int i = 0; i < 50; i++) {
+    Game g = initial;
+    for (int step = 0; step < 150 && g.winner() == 0; step++) {
+      std::vector<Action> legal;
+      g.legal_actions(legal);
+
+      // Every action that could be written down, legal or not
+      std::vector<Action> candidates = {Action{g.cur_player(), PASS}};
+      for (const System& system : g.systems()) {
+        for (const Pyramid& ship : pyramids) {
+          for (ActionType type : {ATTACK, DISCOVER, TRAVEL, BUILD, TRADE,
+                                  SACRIFICE, CATASTROPHE}) {
+            for (const Pyramid& target : pyramids) {
+              candidates.push_back(Action{g.cur_player(), type, system.id, ship,
+                  0, type == DISCOVER || type == TRADE ? target : Pyramid()});
+            }
+            for (const System& to_system : g.systems()) {
+              candidates.push_back(Action{g.cur_player(), type, system.id, ship,
+                  type == TRAVEL ? to_system.id : 0});
+            }
+          }
+        }
+      }
+
+      for (const Action& action : candidates) {
+        bool is_legal = std::find(legal.begin(), legal.end(), action) !=
+          legal.end();
+        if (action.type == CATASTROPHE) {
+          is_legal = std::find_if(legal.begin(), legal.end(),
+              [&action](const Action& a) {
+                return a.type == CATASTROPHE && a.system == action.system &&
+                  a.ship.colour == action.ship.colour;
+              }) != legal.end();
+        }
+        if (g.validate_action(action) != is_legal) {
+          FAIL("validate_action disagrees on action type " << action.type);
+        }
+      }
+      Action wrong_player = legal[0];
+      wrong_player.player = 3 - g.cur_player();
+      REQUIRE_FALSE(g.validate_action(wrong_player));
+
+      Action action = legal[rng.below(legal.size())];
+      g.perform_action(action);
+      positions++;
+    }
+  }
+  REQUIRE(positions > 100);
+}
+
+TEST_CASE("players set up their homeworlds in turn") {
+  Game g = Game(2);
+  std::vector<Action> actions;
+  g.legal_actions(actions);
+
+  // 78 pairs of stars and a large ship of each colour
+  REQUIRE(actions.size() == 312);
+  for (const Action& action : actions) {
+    REQUIRE(action.type == HOMEWORLD);
+    REQUIRE(action.ship.size == LARGE);
+    REQUIRE_FALSE(action.star < action.target);
+    REQUIRE(g.validate_action(action));
+  }
+
+  Action setup = Action{1, HOMEWORLD, 0, Pyramid{LARGE, GREEN}, 0,
+    Pyramid{SMALL, BLUE}, Pyramid{MEDIUM, YELLOW}};
+  Action reversed = setup;
+  std::swap(reversed.target, reversed.star);
+  REQUIRE(g.validate_action(reversed));
+  Action small_ship = setup;
+  small_ship.ship = Pyramid{SMALL, GREEN};
+  REQUIRE_FALSE(g.validate_action(small_ship));
+
+  g.perform_action(setup);
+  REQUIRE(g.homeworlds_built() == 1);
+  REQUIRE(g.winner() == 0);
+  REQUIRE(g.get_system(setup.system_target).player == 1);
+  REQUIRE((g.stash().at(Pyramid{LARGE, GREEN}) == 2));
+
+  actions.clear();
+  g.legal_actions(actions);
+  REQUIRE(actions.size() == 1);
+  REQUIRE(actions[0].type == PASS);
+  g.perform_action(actions[0]);
+  REQUIRE(g.cur_player() == 2);
+
+  // Player 2 may not take the last large green
+  Action greens = Action{2, HOMEWORLD, 0, Pyramid{LARGE, GREEN}, 0,
+    Pyramid{LARGE, GREEN}, Pyramid{SMALL, RED}};
+  REQUIRE(g.validate_action(greens));
+  greens.target = Pyramid{LARGE, GREEN};
+  greens.star = Pyramid{LARGE, GREEN};
+  REQUIRE_FALSE(g.validate_action(greens));
+
+  actions.clear();
+  g.legal_actions(actions);
+  g.perform_action(actions[0]);
+  Action pass = Action{2, PASS};
+  g.perform_action(pass);
+  REQUIRE(g.homeworlds_built() == 2);
+  REQUIRE(g.cur_player() == 1);
+  actions.clear();
+  g.legal_actions(actions);
+  REQUIRE(actions[0].type != HOMEWORLD);
+}
@@ -0,0 +1,54 @@
+#include <vector>
+
+#include "../game.h"
+#include "../mcts.h"
+#include "catch.hpp"
+
+static Game small_position() {
+  Game g = Game(2);
+  int home1 = g.create_system({Pyramid{SMALL, BLUE},
+      Pyramid{MEDIUM, YELLOW}}, 1);
+  int home2 = g.create_system({Pyramid{MEDIUM, YELLOW},
+      Pyramid{LARGE, GREEN}}, 2);
+  g.add_ship(home1, Ship{1, Pyramid{LARGE, GREEN}});
+  g.add_ship(home1, Ship{1, Pyramid{SMALL, RED}});
+  g.add_ship(home2, Ship{2, Pyramid{LARGE, BLUE}});
+  g.set_homeworlds_built(2);
+  return g;
+}
+
+static std::vector<int> child_visits(const Mcts& mcts) {
+  std::vector<int> visits;
+  const MctsNode *root = mcts.tree();
+  for (int i = 0; i < root->num_children; i++) {
+    visits.push_back(root->children[i].visits.load());
+  }
+  return visits;
+}
+
+TEST_CASE("single-threaded mcts is deterministic") {
+  Game g = small_position();
+  Mcts a(&g);
+  Mcts b(&g);
+  std::vector<Action> actions = a.get_actions(500);
+  REQUIRE((b.get_actions(500) == actions));
+  REQUIRE(child_visits(a) == child_visits(b));
+
+  // The seed follows the playout count, so a second search continues alike
+  a.search(200);
+  b.search(200);
+  REQUIRE(child_visits(a) == child_visits(b));
+}
+
+TEST_CASE("multi-threaded mcts visits add up to the playouts") {
+  Game g = small_position();
+  Mcts mcts(&g, 4);
+  mcts.search(2000);
+  REQUIRE(mcts.playouts() == 2000);
+  REQUIRE(mcts.tree()->visits.load() == 2000);
+  int sum = 0;
+  for (int visits : child_visits(mcts)) {
+    sum += visits;
+  }
+  REQUIRE(sum == 2000); // no virtual loss is left behind
+}
@@ -0,0 +1,79 @@
+#include "../game.h"
+#include "../multi_search.h"
+#include "../playout.h"
+#include "../turn.h"
+#include "catch.hpp"
+
+// Player 1 can take the only ship at player 2's home, eliminating them
+static Game kill_in_one() {
+  Game g = Game(3);
+  int home1 = g.create_system({Pyramid{SMALL, BLUE},
+      Pyramid{MEDIUM, YELLOW}}, 1);
+  int home2 = g.create_system({Pyramid{LARGE, GREEN},
+      Pyramid{SMALL, YELLOW}}, 2);
+  int home3 = g.create_system({Pyramid{LARGE, BLUE},
+      Pyramid{SMALL, RED}}, 3);
+  g.add_ship(home1, Ship{1, Pyramid{LARGE, GREEN}});
+  g.add_ship(home2, Ship{1, Pyramid{LARGE, RED}});
+  g.add_ship(home2, Ship{2, Pyramid{SMALL, GREEN}});
+  g.add_ship(home3, Ship{3, Pyramid{LARGE, YELLOW}});
+  g.set_homeworlds_built(3);
+  return g;
+}
+
+// max^n without shallow pruning
+static Scores plain_maxn(MultiSearch& search, const Game *game, int depth) {
+  if (depth == 0 || game->winner() != 0) {
+    return search.evaluate(game);
+  }
+  std::vector<Turn*> turns = get_turns(game);
+  if (turns.empty()) {
+    return search.evaluate(game);
+  }
+  int player = game->cur_player();
+  Scores best;
+  best.fill(0);
+  best[player] = -1;
+  for (const Turn *turn : turns) {
+    Scores value = plain_maxn(search, turn->game, depth - 1);
+    if (value[player] > best[player]) {
+      best = value;
+    }
+  }
+  for (Turn *turn : turns) {
+    delete turn;
+  }
+  return best;
+}
+
+TEST_CASE("every multi-player search mode takes a kill") {
+  for (MultiSearchMode mode : {PARANOID, BEST_REPLY, MAXN}) {
+    for (int depth = 1; depth <= 2; depth++) {
+      Game g = kill_in_one();
+      MultiSearch search(&g, mode);
+      std::vector<Action> actions = search.get_actions(depth);
+      for (Action action : actions) {
+        REQUIRE(g.validate_action(action));
+        g.perform_action(action);
+      }
+      REQUIRE(actions[0].type == ATTACK);
+      REQUIRE(g.eliminated(2));
+    }
+  }
+}
+
+TEST_CASE("max^n shallow pruning keeps the root value") {
+  Rng rng(5);
+  for (int game = 0; game < 8; game++) {
+    Game g = kill_in_one();
+    for (int turn = 0; turn < game && g.winner() == 0; turn++) {
+      random_turn(g, rng);
+    }
+    MultiSearch search(&g, MAXN);
+    int player = g.cur_player();
+    for (int depth = 1; depth <= 3; depth++) {
+      REQUIRE(search.maxn(&g, depth, 0)[player] ==
+              plain_maxn(search, &g, depth)[player]);
+    }
+  }
+}
@@ -0,0 +1,64 @@
+#include <sstream>
+
+#include "../game.h"
+#include "../nnue.h"
+#include "../playout.h"
+#include "catch.hpp"
+
+static void random_network(NnueNetwork& network, Rng& rng) {
+  for (int f = 0; f < NNUE_INPUTS; f++) {
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+      network.input_weights[f][i] = (short)rng.below(64) - 32;
+    }
+  }
+  for (int i = 0; i < NNUE_HIDDEN; i++) {
+    network.input_bias[i] = (short)rng.below(64);
+  }
+  for (int o = 0; o < NNUE_LAYER; o++) {
+    for (int i = 0; i < 2 * NNUE_HIDDEN; i++) {
+      network.layer_weights[o][i] = (signed char)(rng.below(256) - 128);
+    }
+    network.layer_bias[o] = (int)rng.below(4096) - 2048;
+    network.output_weights[o] = (signed char)(rng.below(256) - 128);
+  }
+  network.output_bias = 100;
+  network.widen();
+}
+
+TEST_CASE("NNUE accumulators are updated incrementally") {
+  Rng rng(3);
+  NnueNetwork network;
+  random_network(network, rng);
+
+  Game g = Game(2);
+  int home1 = g.create_system({Pyramid{SMALL, BLUE}, Pyramid{MEDIUM, YELLOW}}, 1);
+  g.add_ship(home1, Ship{1, Pyramid{LARGE, GREEN}});
+  int home2 = g.create_system({Pyramid{LARGE, RED}, Pyramid{SMALL, GREEN}}, 2);
+  g.add_ship(home2, Ship{2, Pyramid{LARGE, YELLOW}});
+  g.set_network(&network);
+
+  for (int turn = 0; turn < 40 && g.winner() == 0; turn++) {
+    random_turn(g, rng);
+
+    Game fresh = g;
+    fresh.set_network(&network);
+    for (int player = 0; player < 2; player++) {
+      for (int i = 0; i < NNUE_HIDDEN; i++) {
+        REQUIRE(g.accumulator().values[player][i] ==
+            fresh.accumulator().values[player][i]);
+      }
+    }
+    REQUIRE(nnue_evaluate(&g) == nnue_evaluate(&fresh));
+  }
+
+  SECTION("networks survive a save and load") {
+    std::stringstream ss;
+    network.save(ss);
+    NnueNetwork loaded;
+    REQUIRE(loaded.load(ss));
+
+    Game copy = g;
+    copy.set_network(&loaded);
+    REQUIRE(nnue_evaluate(&copy) == nnue_evaluate(&g));
+  }
+}
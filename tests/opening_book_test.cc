@@ -0,0 +1,56 @@
+#include <cstdio>
+#include <fstream>
+
+#include "../game.h"
+#include "../opening_book.h"
+#include "catch.hpp"
+
+TEST_CASE("opening books give the best legal setup") {
+  Game root = Game(2);
+  PositionKey key = encode_position(root);
+  Action good = Action{0, HOMEWORLD, 0, Pyramid{LARGE, GREEN}, 0,
+    Pyramid{SMALL, BLUE}, Pyramid{MEDIUM, YELLOW}};
+  Action bad = Action{0, HOMEWORLD, 0, Pyramid{LARGE, RED}, 0,
+    Pyramid{SMALL, RED}, Pyramid{SMALL, YELLOW}};
+  Action illegal = Action{0, HOMEWORLD, 0, Pyramid{SMALL, RED}, 0,
+    Pyramid{SMALL, RED}, Pyramid{SMALL, YELLOW}};
+
+  Game after = root;
+  Action setup = good;
+  setup.player = 1;
+  after.perform_action(setup);
+  Action pass = Action{1, PASS};
+  after.perform_action(pass);
+
+  const char *filename = "opening_book_test.bin";
+  {
+    std::ofstream out(filename, std::ios::binary);
+    write_book(out, {BookEntry{key, bad, 4, 3},
+        BookEntry{encode_position(after), good, 2, 2},
+        BookEntry{key, good, 4, 6}, BookEntry{key, illegal, 4, 8}});
+  }
+
+  OpeningBook book;
+  REQUIRE(book.open(filename));
+  REQUIRE(book.size() == 4);
+  std::vector<BookEntry> entries = book.find(key);
+  REQUIRE(entries.size() == 3);
+  REQUIRE(entries[0].score() == Approx(1.0));
+  REQUIRE((entries[1].setup == good));
+  REQUIRE(entries[1].games == 4);
+  REQUIRE(entries[1].points == 6);
+
+  Action chosen;
+  REQUIRE(book.lookup(root, chosen));
+  REQUIRE((chosen == good));
+  REQUIRE(chosen.player == 1);
+
+  REQUIRE(book.lookup(after, chosen));
+  REQUIRE(chosen.player == 2);
+  REQUIRE(book.find(encode_position(after)).size() == 1);
+
+  Game missing = root;
+  missing.set_cur_player(2);
+  REQUIRE_FALSE(book.lookup(missing, chosen));
+  std::remove(filename);
+}
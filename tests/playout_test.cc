@@ -0,0 +1,71 @@
+#include "../game.h"
+#include "../playout.h"
+#include "catch.hpp"
+
+static bool is_legal(const Game& game, const Action& action) {
+  std::vector<Action> actions;
+  game.legal_actions(actions);
+  for (const Action& legal : actions) {
+    if (action.type == CATASTROPHE ? legal.type == CATASTROPHE &&
+          legal.system == action.system &&
+          legal.ship.colour == action.ship.colour :
+        legal == action) {
+      return true;
+    }
+  }
+  return false;
+}
+
+TEST_CASE("random turns only perform legal actions") {
+  Game g = Game(2);
+
+  int home1 = g.create_system({Pyramid{SMALL, BLUE}, Pyramid{MEDIUM, YELLOW}}, 1);
+  g.add_ship(home1, Ship{1, Pyramid{LARGE, GREEN}});
+  g.add_ship(home1, Ship{1, Pyramid{SMALL, RED}});
+  int home2 = g.create_system({Pyramid{LARGE, RED}, Pyramid{SMALL, GREEN}}, 2);
+  g.add_ship(home2, Ship{2, Pyramid{LARGE, YELLOW}});
+  g.add_ship(home2, Ship{2, Pyramid{MEDIUM, BLUE}});
+  int colony = g.create_system({Pyramid{LARGE, BLUE}});
+  g.add_ship(colony, Ship{1, Pyramid{MEDIUM, GREEN}});
+  g.add_ship(colony, Ship{2, Pyramid{SMALL, GREEN}});
+
+  for (unsigned long long seed = 1; seed <= 20; seed++) {
+    Game game = g;
+    Rng rng(seed);
+    for (int turn = 0; turn < 30 && game.winner() == 0; turn++) {
+      Game replay = game;
+      std::vector<Action> trace;
+      REQUIRE(random_turn(game, rng, UNIFORM_POLICY, &trace));
+      REQUIRE(trace.back().type == PASS);
+
+      for (Action& action : trace) {
+        REQUIRE(is_legal(replay, action));
+        replay.perform_action(action);
+      }
+      REQUIRE(replay.hash() == game.hash());
+    }
+  }
+
+  SECTION("playouts are reproducible for a given seed") {
+    Game game1 = g;
+    Game game2 = g;
+    Rng rng1(42);
+    Rng rng2(42);
+    int winner1 = random_playout(game1, rng1);
+    int winner2 = random_playout(game2, rng2);
+
+    REQUIRE(winner1 == winner2);
+    REQUIRE(game1.hash() == game2.hash());
+  }
+
+  SECTION("zero weights exclude action types") {
+    PlayoutPolicy policy = {{1, 0, 0, 0, 1, 0, 0, 0}};
+    Rng rng(7);
+    std::vector<Action> trace;
+    REQUIRE(random_turn(g, rng, policy, &trace));
+
+    REQUIRE(trace.size() == 2);
+    REQUIRE(trace[0].type == BUILD);
+    REQUIRE(trace[1].type == PASS);
+  }
+}
@@ -0,0 +1,100 @@
+#include "../game.h"
+#include "../negamax.h"
+#include "../position_history.h"
+#include "../turn.h"
+#include "catch.hpp"
+
+TEST_CASE("position history counts repeated keys") {
+  PositionHistory history(4);
+  history.push(5);
+  history.push(21); // same low bits as 5
+  history.push(5);
+  REQUIRE(history.size() == 3);
+  REQUIRE(history.count(5) == 2);
+  REQUIRE(history.count(21) == 1);
+  REQUIRE(history.count(37) == 0);
+  REQUIRE(history.count(6) == 0);
+
+  history.pop();
+  REQUIRE(history.count(5) == 1);
+  REQUIRE(history.back() == 21);
+  history.clear();
+  REQUIRE(history.size() == 0);
+  REQUIRE(history.count(5) == 0);
+  REQUIRE(history.count(21) == 0);
+}
+
+static Game small_position() {
+  Game g = Game(2);
+  int home1 = g.create_system({Pyramid{SMALL, BLUE},
+      Pyramid{MEDIUM, YELLOW}}, 1);
+  int home2 = g.create_system({Pyramid{MEDIUM, YELLOW},
+      Pyramid{LARGE, GREEN}}, 2);
+  g.add_ship(home1, Ship{1, Pyramid{LARGE, GREEN}});
+  g.add_ship(home2, Ship{2, Pyramid{SMALL, GREEN}});
+  return g;
+}
+
+TEST_CASE("negamax scores repeated positions as draws") {
+  Game g = small_position();
+  PositionHistory history;
+  history.push(g.key());
+  Negamax negamax(&g);
+  negamax.set_history(history);
+  REQUIRE(negamax.negamax(&g, 2, -10000000, 10000000) == 0);
+  REQUIRE(negamax.stats().repetitions == 1);
+  REQUIRE(negamax.stats().nodes == 1);
+
+  // With every reply leading back to an earlier position, the root is a draw
+  history.clear();
+  std::vector<Turn*> turns = get_turns(&g);
+  for (const Turn *turn : turns) {
+    history.push(turn->game->key());
+  }
+  negamax.set_history(history);
+  negamax.reset_stats();
+  negamax.get_actions(2);
+  REQUIRE(negamax.value() == 0);
+  REQUIRE(negamax.stats().repetitions == (long long)turns.size());
+  for (Turn *turn : turns) {
+    delete turn;
+  }
+}
+
+TEST_CASE("repetition draws are not kept as transpositions") {
+  Game g = small_position();
+  Negamax fresh(&g);
+  int value = fresh.negamax(&g, 2, -10000000, 10000000);
+  REQUIRE(value != 0);
+
+  // Every reply repeats the history, so g is a draw on this path only
+  PositionHistory history;
+  std::vector<Turn*> turns = get_turns(&g);
+  for (const Turn *turn : turns) {
+    history.push(turn->game->key());
+  }
+  Negamax negamax(&g);
+  negamax.set_history(history);
+  REQUIRE(negamax.negamax(&g, 2, -10000000, 10000000) == 0);
+
+  negamax.set_history(PositionHistory());
+  negamax.reset_stats();
+  REQUIRE(negamax.negamax(&g, 2, -10000000, 10000000) == value);
+  REQUIRE(negamax.stats().tt_cutoffs == 0);
+  for (Turn *turn : turns) {
+    delete turn;
+  }
+}
+
+TEST_CASE("a stopped iteration keeps the last complete depth and value") {
+  Game g = small_position();
+  Negamax negamax(&g);
+  negamax.get_actions(1);
+  int value = negamax.value();
+  REQUIRE(negamax.stats().depth == 1);
+
+  negamax.stop();
+  negamax.get_actions(2);
+  REQUIRE(negamax.value() == value);
+  REQUIRE(negamax.stats().depth == 1);
+}
@@ -0,0 +1,74 @@
+#include <set>
+#include <unordered_set>
+
+#include "../game.h"
+#include "../playout.h"
+#include "../position_key.h"
+#include "catch.hpp"
+
+static Game start_position() {
+  Game g = Game(2);
+  int home1 = g.create_system({Pyramid{SMALL, BLUE},
+      Pyramid{MEDIUM, YELLOW}}, 1);
+  int home2 = g.create_system({Pyramid{LARGE, GREEN},
+      Pyramid{MEDIUM, YELLOW}}, 2);
+  g.add_ship(home1, Ship{1, Pyramid{LARGE, GREEN}});
+  g.add_ship(home2, Ship{2, Pyramid{LARGE, BLUE}});
+  return g;
+}
+
+TEST_CASE("position keys decode to the encoded position") {
+  Rng rng(3);
+  std::set<unsigned long long> game_keys;
+  std::set<PositionKey> position_keys;
+  std::unordered_set<PositionKey> hashed_keys;
+  for (int i = 0; i < 20; i++) {
+    Game g = start_position();
+    for (int turn = 0; turn < 40 && g.winner() == 0; turn++) {
+      random_turn(g, rng, UNIFORM_POLICY);
+      PositionKey key = encode_position(g);
+      Game *decoded = decode_position(key);
+      REQUIRE(decoded->key() == g.key());
+      REQUIRE(decoded->hash_string() == g.hash_string());
+      REQUIRE(decoded->stash() == g.stash());
+      REQUIRE(encode_position(*decoded) == key);
+      delete decoded;
+
+      game_keys.insert(g.key());
+      position_keys.insert(key);
+      hashed_keys.insert(key);
+    }
+  }
+  REQUIRE(position_keys.size() == game_keys.size());
+  REQUIRE(hashed_keys.size() == game_keys.size());
+}
+
+TEST_CASE("position keys do not depend on system order") {
+  Game a = start_position();
+  int a1 = a.create_system({Pyramid{SMALL, RED}});
+  int a2 = a.create_system({Pyramid{LARGE, RED}});
+  a.add_ship(a1, Ship{1, Pyramid{SMALL, GREEN}});
+  a.add_ship(a1, Ship{2, Pyramid{MEDIUM, GREEN}});
+  a.add_ship(a2, Ship{2, Pyramid{SMALL, GREEN}});
+
+  Game b = Game(2);
+  int b2 = b.create_system({Pyramid{LARGE, RED}});
+  b.add_ship(b2, Ship{2, Pyramid{SMALL, GREEN}});
+  int home2 = b.create_system({Pyramid{MEDIUM, YELLOW},
+      Pyramid{LARGE, GREEN}}, 2);
+  b.add_ship(home2, Ship{2, Pyramid{LARGE, BLUE}});
+  int b1 = b.create_system({Pyramid{SMALL, RED}});
+  b.add_ship(b1, Ship{2, Pyramid{MEDIUM, GREEN}});
+  b.add_ship(b1, Ship{1, Pyramid{SMALL, GREEN}});
+  int home1 = b.create_system({Pyramid{MEDIUM, YELLOW},
+      Pyramid{SMALL, BLUE}}, 1);
+  b.add_ship(home1, Ship{1, Pyramid{LARGE, GREEN}});
+
+  REQUIRE(encode_position(a) == encode_position(b));
+  REQUIRE(hash(encode_position(a)) == hash(encode_position(b)));
+
+  b.set_cur_player(2);
+  REQUIRE(encode_position(a) != encode_position(b));
+  REQUIRE(((encode_position(a) < encode_position(b)) !=
+           (encode_position(b) < encode_position(a))));
+}
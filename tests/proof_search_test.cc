@@ -0,0 +1,74 @@
+#include "../game.h"
+#include "../proof_search.h"
+#include "catch.hpp"
+
+// Player 2 wins in three turns: two trades to red and an attack
+static Game win_in_three() {
+  Game g = Game(2);
+  int home1 = g.create_system({Pyramid{SMALL, BLUE},
+      Pyramid{MEDIUM, YELLOW}}, 1);
+  int home2 = g.create_system({Pyramid{MEDIUM, YELLOW},
+      Pyramid{LARGE, GREEN}}, 2);
+  g.add_ship(home1, Ship{2, Pyramid{SMALL, GREEN}});
+  g.add_ship(home1, Ship{1, Pyramid{SMALL, BLUE}});
+  g.add_ship(home2, Ship{2, Pyramid{SMALL, GREEN}});
+  g.set_cur_player(2);
+  return g;
+}
+
+static void play_line(Game& g, const std::vector<std::vector<Action>>& line) {
+  for (const std::vector<Action>& turn : line) {
+    for (Action action : turn) {
+      REQUIRE(g.validate_action(action));
+      g.perform_action(action);
+    }
+  }
+}
+
+TEST_CASE("proof search proves forced wins") {
+  Game g = win_in_three();
+  ProofSearch search(1);
+  REQUIRE(search.solve(&g, 1, 100000) == DISPROVEN);
+  REQUIRE(search.solve(&g, 2, 100000) == DISPROVEN);
+  REQUIRE(search.solve(&g, 3, 100000) == PROVEN);
+  REQUIRE(search.line().size() == 3);
+  play_line(g, search.line());
+  REQUIRE(g.winner() == 2);
+}
+
+TEST_CASE("proof search resumes in slices") {
+  Game g = win_in_three();
+  ProofSearch whole(1), sliced(1);
+  REQUIRE(whole.solve(&g, 3, 100000) == PROVEN);
+  REQUIRE(whole.nodes() > 2);
+
+  ProofResult result = UNKNOWN;
+  int slices = 0;
+  for (; result == UNKNOWN && slices < 1000; slices++) {
+    result = sliced.solve(&g, 3, 1);
+  }
+  REQUIRE(result == PROVEN);
+  REQUIRE(slices > 1);
+  play_line(g, sliced.line());
+  REQUIRE(g.winner() == 2);
+
+  Game fresh = win_in_three();
+  ProofSearch stopped(1);
+  stopped.stop();
+  REQUIRE(stopped.solve(&fresh, 3, 100000) == UNKNOWN);
+  stopped.resume();
+  REQUIRE(stopped.solve(&fresh, 3, 100000) == PROVEN);
+}
+
+TEST_CASE("proof search fails where there is no forced win") {
+  Game g = Game(2);
+  int home1 = g.create_system({Pyramid{SMALL, BLUE},
+      Pyramid{MEDIUM, YELLOW}}, 1);
+  int home2 = g.create_system({Pyramid{LARGE, GREEN},
+      Pyramid{MEDIUM, YELLOW}}, 2);
+  g.add_ship(home1, Ship{1, Pyramid{LARGE, GREEN}});
+  g.add_ship(home2, Ship{2, Pyramid{LARGE, BLUE}});
+  ProofSearch search(1);
+  REQUIRE(search.solve(&g, 3, 100000) == DISPROVEN);
+  REQUIRE(search.line().empty());
+}
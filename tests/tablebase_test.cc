@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <set>
+
+#include "../game.h"
+#include "../negamax.h"
+#include "../tablebase.h"
+#include "catch.hpp"
+
+static Game start_position() {
+  Game g = Game(2);
+  int home1 = g.create_system({Pyramid{SMALL, BLUE},
+      Pyramid{MEDIUM, YELLOW}}, 1);
+  int home2 = g.create_system({Pyramid{LARGE, GREEN},
+      Pyramid{MEDIUM, YELLOW}}, 2);
+  g.add_ship(home1, Ship{1, Pyramid{LARGE, GREEN}});
+  g.add_ship(home2, Ship{2, Pyramid{LARGE, BLUE}});
+  return g;
+}
+
+TEST_CASE("tablebases give back the written results") {
+  // Keys sharing long and short prefixes
+  std::set<PositionKey> keys;
+  for (unsigned long long i = 0; i < 1000; i++) {
+    keys.insert(PositionKey{{i / 100, i / 10, i * 0x9e3779b97f4a7c15ULL, i}});
+  }
+
+  // Every third key is left out
+  std::vector<TablebaseEntry> entries;
+  std::vector<PositionKey> missing;
+  int i = 0;
+  for (const PositionKey& key : keys) {
+    int turns = i % 200 + 1;
+    if (i % 3 == 2) {
+      missing.push_back(key);
+    } else {
+      entries.push_back(TablebaseEntry{key, i % 2 ? -turns : turns});
+    }
+    i++;
+  }
+  REQUIRE(entries.size() > 3 * TABLEBASE_BLOCK);
+
+  const char *filename = "tablebase_test.bin";
+  {
+    std::ofstream out(filename, std::ios::binary);
+    write_tablebase(out, 36, entries);
+  }
+  Tablebase tablebase;
+  REQUIRE(tablebase.open(filename));
+  REQUIRE(tablebase.size() == entries.size());
+  REQUIRE(tablebase.max_ships() == 36);
+  for (const TablebaseEntry& entry : entries) {
+    int turns = 0;
+    REQUIRE(tablebase.probe(entry.key, turns));
+    REQUIRE(turns == entry.turns);
+  }
+  for (const PositionKey& key : missing) {
+    int turns;
+    REQUIRE_FALSE(tablebase.probe(key, turns));
+  }
+  std::remove(filename);
+}
+
+TEST_CASE("negamax scores tablebase positions as won or lost") {
+  Game g = start_position();
+  Game more = g;
+  more.add_ship(more.systems()[0].id, Ship{1, Pyramid{SMALL, RED}});
+
+  const char *filename = "tablebase_test.bin";
+  {
+    std::ofstream out(filename, std::ios::binary);
+    write_tablebase(out, 2, {TablebaseEntry{encode_position(g), -4},
+        TablebaseEntry{encode_position(more), 3}});
+  }
+  Tablebase tablebase;
+  REQUIRE(tablebase.open(filename));
+  int turns;
+  REQUIRE(tablebase.probe(g, turns));
+  REQUIRE(turns == -4);
+  REQUIRE_FALSE(tablebase.probe(more, turns)); // too many ships
+
+  Negamax negamax(&g);
+  negamax.set_tablebase(&tablebase);
+  REQUIRE(negamax.negamax(&g, 2, -10000000, 10000000) == -1000000 + 4);
+  REQUIRE(negamax.stats().tablebase_hits == 1);
+  REQUIRE(negamax.stats().nodes == 1);
+  std::remove(filename);
+}
+
+TEST_CASE("retrograde analysis finds wins, losses and escapes") {
+  std::vector<TablebaseNode> nodes = {
+    TablebaseNode{true, false, {}}, // 0 wins at once
+    TablebaseNode{false, false, {0}}, // 1 can only let 0 win
+    TablebaseNode{false, false, {1, 0}}, // 2 can reach lost 1
+    TablebaseNode{false, false, {}}, // 3 loses whatever it does
+    TablebaseNode{false, false, {3, 1}}, // 4 wins sooner through 3
+    TablebaseNode{false, true, {0}}, // 5 would be lost but may escape
+    TablebaseNode{false, false, {5}}, // 6 reaches an unknown position
+    TablebaseNode{false, false, {0, 2}}, // 7 loses at the latest through 2
+  };
+  std::vector<int> turns = retrograde(nodes);
+  REQUIRE(turns == std::vector<int>({1, -2, 3, -1, 2, 0, 0, -4}));
+}
+
+static Game endgame_position(const std::vector<Pyramid>& home2, Ship ship1,
+                             Ship ship2, int player) {
+  Game g = Game(2);
+  int home1 = g.create_system({Pyramid{SMALL, BLUE},
+      Pyramid{MEDIUM, YELLOW}}, 1);
+  g.add_ship(home1, ship1);
+  g.add_ship(g.create_system(home2, 2), ship2);
+  g.set_cur_player(player);
+  return g;
+}
+
+TEST_CASE("endgame tables are built from the enumerated positions") {
+  Game start = start_position();
+  std::vector<PositionKey> keys = enumerate_endgame({&start}, 2);
+  REQUIRE(std::is_sorted(keys.begin(), keys.end()));
+  std::vector<TablebaseNode> nodes;
+  for (size_t i = 0; i < keys.size(); i++) {
+    nodes.push_back(generate_node(keys, i, 2));
+  }
+  std::vector<int> turns = retrograde(nodes);
+  std::vector<TablebaseEntry> entries;
+  for (size_t i = 0; i < keys.size(); i++) {
+    REQUIRE_FALSE((nodes[i].escape && turns[i] < 0));
+    if (turns[i] != 0) {
+      entries.push_back(TablebaseEntry{keys[i], turns[i]});
+    }
+  }
+
+  const char *filename = "tablebase_test.bin";
+  {
+    std::ofstream out(filename, std::ios::binary);
+    write_tablebase(out, 2, entries);
+  }
+  Tablebase tablebase;
+  REQUIRE(tablebase.open(filename));
+  std::remove(filename);
+
+  // After a catastrophe left player 2 only yellow, their ship can only move
+  // away from home
+  Game lost = endgame_position({Pyramid{MEDIUM, YELLOW}},
+      Ship{1, Pyramid{SMALL, BLUE}}, Ship{2, Pyramid{SMALL, YELLOW}}, 2);
+  int result = 0;
+  REQUIRE(tablebase.probe(lost, result));
+  REQUIRE(result == -1);
+
+  // Player 1 keeps that position by trading at home
+  Game won = endgame_position({Pyramid{MEDIUM, YELLOW}},
+      Ship{1, Pyramid{SMALL, BLUE}}, Ship{2, Pyramid{SMALL, YELLOW}}, 1);
+  REQUIRE(tablebase.probe(won, result));
+  REQUIRE(result == 2);
+
+  // Building a third ship leaves the table
+  Game escaping = endgame_position({Pyramid{MEDIUM, YELLOW},
+      Pyramid{LARGE, GREEN}}, Ship{1, Pyramid{SMALL, BLUE}},
+      Ship{2, Pyramid{MEDIUM, BLUE}}, 2);
+  auto it = std::lower_bound(keys.begin(), keys.end(),
+      encode_position(escaping));
+  REQUIRE(it != keys.end());
+  REQUIRE(nodes[it - keys.begin()].escape);
+  REQUIRE_FALSE(tablebase.probe(escaping, result));
+}
@@ -0,0 +1,103 @@
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+#include "trace.h"
+
+#ifdef TRACE
+
+// Events past this many per thread are counted but not kept
+const static size_t MAX_EVENTS = 1 << 22;
+
+struct TraceEvent {
+  const char *name;
+  const char *arg_name;
+  long long arg;
+  long long start; // ns
+  long long duration; // ns
+};
+
+struct TraceBuffer {
+  int tid;
+  std::vector<TraceEvent> events;
+  long long dropped;
+};
+
+static std::mutex registry_lock;
+static std::vector<TraceBuffer*> buffers; // never freed, threads may exit
+
+static long long now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Only a thread's first event takes the registry lock
+static TraceBuffer *thread_buffer() {
+  thread_local TraceBuffer *buffer = nullptr;
+  if (buffer == nullptr) {
+    std::lock_guard<std::mutex> lock(registry_lock);
+    buffer = new TraceBuffer{(int)buffers.size() + 1, {}, 0};
+    buffers.push_back(buffer);
+  }
+  return buffer;
+}
+
+TraceScope::TraceScope(const char *name, const char *arg_name, long long arg) :
+    name(name), arg_name(arg_name), arg(arg), start(now_ns()) {}
+
+TraceScope::~TraceScope() {
+  long long end = now_ns();
+  TraceBuffer *buffer = thread_buffer();
+  if (buffer->events.size() < MAX_EVENTS) {
+    buffer->events.push_back(
+        TraceEvent{name, arg_name, arg, start, end - start});
+  } else {
+    buffer->dropped++;
+  }
+}
+
+void trace_dump(std::ostream& os) {
+  std::lock_guard<std::mutex> lock(registry_lock);
+  long long origin = -1;
+  for (const TraceBuffer *buffer : buffers) {
+    for (const TraceEvent& event : buffer->events) {
+      if (origin < 0 || event.start < origin) {
+        origin = event.start;
+      }
+    }
+  }
+
+  std::ios::fmtflags flags = os.flags();
+  os << std::fixed << std::setprecision(3); // microseconds to the ns
+  os << "{\"traceEvents\":[";
+  bool first = true;
+  for (const TraceBuffer *buffer : buffers) {
+    for (const TraceEvent& event : buffer->events) {
+      os << (first ? "\n" : ",\n");
+      first = false;
+      os << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1";
+      os << ",\"tid\":" << buffer->tid;
+      os << ",\"ts\":" << (event.start - origin) / 1000.0;
+      os << ",\"dur\":" << event.duration / 1000.0;
+      if (event.arg_name != nullptr) {
+        os << ",\"args\":{\"" << event.arg_name << "\":" << event.arg << "}";
+      }
+      os << "}";
+    }
+  }
+  os << "\n],\"otherData\":{\"dropped\":[";
+  for (unsigned int i = 0; i < buffers.size(); i++) {
+    os << (i > 0 ? "," : "") << buffers[i]->dropped;
+  }
+  os << "]}}" << std::endl;
+  os.flags(flags);
+}
+
+#else
+
+void trace_dump(std::ostream& os) {
+  os << "{\"traceEvents\":[]}" << std::endl;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <iostream>
+
+// Scoped trace events in the Chrome trace format, for chrome://tracing or
+// Perfetto. When built with -DTRACE, TRACE_SCOPE records the time spent in
+// the enclosing scope into a buffer owned by the current thread, so recording
+// takes no locks. Without TRACE the macros expand to nothing.
+
+#ifdef TRACE
+
+class TraceScope {
+  public:
+    TraceScope(const char *name, const char *arg_name = nullptr,
+               long long arg = 0);
+    ~TraceScope();
+
+  private:
+    const char *name; // must outlive the trace, normally a literal
+    const char *arg_name;
+    long long arg;
+    long long start;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) \
+  TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_SCOPE_ARG(name, arg_name, arg) \
+  TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name, arg_name, arg)
+
+#else
+
+#define TRACE_SCOPE(name)
+#define TRACE_SCOPE_ARG(name, arg_name, arg)
+
+#endif
+
+// Writes the events recorded so far by all threads as Chrome trace JSON.
+// Traced threads must not be running. Without TRACE the trace is empty.
+void trace_dump(std::ostream& os);
+
+#endif
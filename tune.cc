@@ -0,0 +1,251 @@
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "evaluator.h"
+#include "game.h"
+#include "game_parser.h"
+
+// Fits evaluation weights to game outcomes by minimizing the logistic loss
+// of sigmoid(K * eval) against the result for the player to move.
+//
+// The corpus is a sequence of records, each a line with the winning player
+// (0 for a draw) followed by a game state in the usual format and a blank
+// line. Feature differences are stored per feature so the inner loops
+// vectorize, and both loading and the gradient are split across threads.
+//
+// Usage: ./tune <corpus> <output weight file> [threads] [iterations]
+//             [initial weight file]
+
+const static int BLOCK_SIZE = 1 << 25;
+const static double LEARNING_RATE = 2.0;
+
+struct Corpus {
+  std::vector<short> features[NUM_FEATURES]; // mover minus opponent
+  std::vector<float> results; // 1 win, 0.5 draw, 0 loss for the mover
+
+  void append(const Corpus& other) {
+    for (int f = 0; f < NUM_FEATURES; f++) {
+      features[f].insert(features[f].end(),
+          other.features[f].begin(), other.features[f].end());
+    }
+    results.insert(results.end(), other.results.begin(), other.results.end());
+  }
+};
+
+static void parse_records(const char *begin, const char *end,
+                          const Evaluator& evaluator, Corpus& corpus) {
+  GameParser parser(begin, end);
+  int values[NUM_FEATURES];
+  int other_values[NUM_FEATURES];
+  int winner;
+  while (parser.read_int(winner)) {
+    Game *g = parser.read_game();
+    if (g == nullptr) {
+      continue;
+    }
+    int player = g->cur_player();
+    if (g->num_players() == 2 && g->winner() == 0) {
+      evaluator.features(g, player, values);
+      evaluator.features(g, 3 - player, other_values);
+      for (int f = 0; f < NUM_FEATURES; f++) {
+        corpus.features[f].push_back(values[f] - other_values[f]);
+      }
+      corpus.results.push_back(
+          winner == player ? 1.0f : winner == 0 ? 0.5f : 0.0f);
+    }
+    delete g;
+  }
+}
+
+// Splits text at record boundaries and parses the pieces in parallel
+static void parse_block(const std::string& text, const Evaluator& evaluator,
+                        int num_threads, Corpus& corpus) {
+  std::vector<std::pair<size_t, size_t> > pieces;
+  size_t start = 0;
+  for (int i = 1; i <= num_threads; i++) {
+    size_t end = text.size() * i / num_threads;
+    end = i == num_threads ? text.size() : text.find("\n\n", end);
+    end = end == std::string::npos ? text.size() : std::min(end + 2, text.size());
+    if (end > start) {
+      pieces.push_back(std::make_pair(start, end));
+    }
+    start = std::max(start, end);
+  }
+
+  std::vector<Corpus> parsed(pieces.size());
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < pieces.size(); i++) {
+    threads.push_back(std::thread(parse_records,
+          text.data() + pieces[i].first, text.data() + pieces[i].second,
+          std::cref(evaluator), std::ref(parsed[i])));
+  }
+  for (unsigned int i = 0; i < threads.size(); i++) {
+    threads[i].join();
+    corpus.append(parsed[i]);
+  }
+}
+
+static void load_corpus(std::istream& is, const Evaluator& evaluator,
+                        int num_threads, Corpus& corpus) {
+  std::string carry;
+  std::vector<char> block(BLOCK_SIZE);
+  while (is) {
+    is.read(block.data(), block.size());
+    std::string text = carry + std::string(block.data(), is.gcount());
+    size_t cut = text.rfind("\n\n");
+    if (cut == std::string::npos || !is) {
+      carry = text;
+      continue;
+    }
+    carry = text.substr(cut + 2);
+    text.resize(cut + 2);
+    parse_block(text, evaluator, num_threads, corpus);
+  }
+  parse_block(carry, evaluator, num_threads, corpus);
+}
+
+// Accumulates the loss and its gradient over positions [begin, end)
+static void gradient(const Corpus& corpus, const double *weights, double k,
+                     size_t begin, size_t end, double *loss, double *grad) {
+  std::vector<float> evals(end - begin, 0.0f);
+  for (int f = 0; f < NUM_FEATURES; f++) {
+    const short *x = corpus.features[f].data() + begin;
+    float w = weights[f];
+    for (size_t n = 0; n < evals.size(); n++) {
+      evals[n] += w * x[n];
+    }
+  }
+
+  const float *y = corpus.results.data() + begin;
+  double total = 0;
+  for (size_t n = 0; n < evals.size(); n++) {
+    float p = 1.0f / (1.0f + std::exp(-k * evals[n]));
+    p = std::min(std::max(p, 1e-6f), 1.0f - 1e-6f);
+    total -= y[n] * std::log(p) + (1.0f - y[n]) * std::log(1.0f - p);
+    evals[n] = (p - y[n]) * k; // reuse as d(loss)/d(eval)
+  }
+  *loss = total;
+
+  for (int f = 0; f < NUM_FEATURES; f++) {
+    const short *x = corpus.features[f].data() + begin;
+    double sum = 0;
+    for (size_t n = 0; n < evals.size(); n++) {
+      sum += evals[n] * x[n];
+    }
+    grad[f] = sum;
+  }
+}
+
+static double evaluate_loss(const Corpus& corpus, const double *weights,
+                            double k, int num_threads, double *grad) {
+  size_t size = corpus.results.size();
+  std::vector<double> losses(num_threads, 0);
+  std::vector<std::vector<double> > grads(num_threads,
+      std::vector<double>(NUM_FEATURES, 0));
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.push_back(std::thread(gradient, std::cref(corpus), weights, k,
+          size * i / num_threads, size * (i + 1) / num_threads,
+          &losses[i], grads[i].data()));
+  }
+  double loss = 0;
+  for (int f = 0; grad != nullptr && f < NUM_FEATURES; f++) {
+    grad[f] = 0;
+  }
+  for (int i = 0; i < num_threads; i++) {
+    threads[i].join();
+    loss += losses[i];
+    for (int f = 0; grad != nullptr && f < NUM_FEATURES; f++) {
+      grad[f] += grads[i][f] / size;
+    }
+  }
+  return loss / size;
+}
+
+// Finds the K that best fits the initial weights, as in Texel tuning
+static double fit_scale(const Corpus& corpus, const double *weights,
+                        int num_threads) {
+  double lo = std::log(1e-5);
+  double hi = std::log(1e-1);
+  for (int i = 0; i < 40; i++) {
+    double m1 = lo + (hi - lo) / 3;
+    double m2 = hi - (hi - lo) / 3;
+    if (evaluate_loss(corpus, weights, std::exp(m1), num_threads, nullptr) <
+        evaluate_loss(corpus, weights, std::exp(m2), num_threads, nullptr)) {
+      hi = m2;
+    } else {
+      lo = m1;
+    }
+  }
+  return std::exp((lo + hi) / 2);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 3) {
+    std::cerr << "usage: ./tune <corpus> <output weight file> [threads] "
+      "[iterations] [initial weight file]" << std::endl;
+    return 1;
+  }
+  int num_threads = argc > 3 ? std::atoi(argv[3]) :
+    std::thread::hardware_concurrency();
+  int iterations = argc > 4 ? std::atoi(argv[4]) : 1000;
+  if (num_threads < 1) {
+    num_threads = 1;
+  }
+
+  Evaluator evaluator;
+  if (argc > 5) {
+    std::ifstream weights(argv[5]);
+    if (!weights || !evaluator.load(weights)) {
+      std::cerr << "could not load weights from " << argv[5] << std::endl;
+      return 1;
+    }
+  }
+
+  std::ifstream in(argv[1], std::ios::binary);
+  if (!in) {
+    std::cerr << "could not open " << argv[1] << std::endl;
+    return 1;
+  }
+  Corpus corpus;
+  load_corpus(in, evaluator, num_threads, corpus);
+  std::cerr << "positions " << corpus.results.size() << std::endl;
+  if (corpus.results.empty()) {
+    return 1;
+  }
+
+  double weights[NUM_FEATURES];
+  for (int f = 0; f < NUM_FEATURES; f++) {
+    weights[f] = evaluator.weight((Feature)f);
+  }
+  double k = fit_scale(corpus, weights, num_threads);
+  std::cerr << "scale " << k << std::endl;
+
+  // Adam
+  double grad[NUM_FEATURES];
+  double m[NUM_FEATURES] = {0};
+  double v[NUM_FEATURES] = {0};
+  for (int i = 1; i <= iterations; i++) {
+    double loss = evaluate_loss(corpus, weights, k, num_threads, grad);
+    for (int f = 0; f < NUM_FEATURES; f++) {
+      m[f] = 0.9 * m[f] + 0.1 * grad[f];
+      v[f] = 0.999 * v[f] + 0.001 * grad[f] * grad[f];
+      double m_hat = m[f] / (1 - std::pow(0.9, i));
+      double v_hat = v[f] / (1 - std::pow(0.999, i));
+      weights[f] -= LEARNING_RATE * m_hat / (std::sqrt(v_hat) + 1e-12);
+    }
+    if (i % 50 == 0 || i == iterations) {
+      std::cerr << "iteration " << i << " loss " << loss << std::endl;
+    }
+  }
+
+  for (int f = 0; f < NUM_FEATURES; f++) {
+    evaluator.set_weight((Feature)f, (int)std::lround(weights[f]));
+  }
+  std::ofstream out(argv[2]);
+  evaluator.save(out);
+}
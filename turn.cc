@@ -0,0 +1,42 @@
+#include <unordered_map>
+
+#include "trace.h"
+#include "turn.h"
+
+Turn::~Turn() {
+  delete game;
+}
+
+std::vector<Turn*> get_turns(const Game *game) {
+  TRACE_SCOPE("get_turns");
+  std::unordered_map<int, Turn*> result;
+  std::vector<Action> actions;
+  game->legal_actions(actions);
+
+  for (Action& action : actions) {
+    if (action.type == PASS) {
+      Game *g = new Game(*game);
+      g->perform_action(action);
+      result.emplace(g->hash(), new Turn{g, std::deque<Action>({action})});
+      continue;
+    }
+
+    Game *g = new Game(*game);
+    g->perform_action(action);
+    for (Turn *turn : get_turns(g)) {
+      if (result.count(turn->game->hash()) == 0) {
+        turn->actions.push_front(action);
+        result.emplace(turn->game->hash(), turn);
+      } else {
+        delete turn;
+      }
+    }
+    delete g;
+  }
+
+  std::vector<Turn*> real_result;
+  for (const auto& p : result) {
+    real_result.push_back(p.second);
+  }
+  return real_result;
+}
@@ -0,0 +1,20 @@
+#ifndef TURN_H
+#define TURN_H
+
+#include <deque>
+#include <vector>
+
+#include "game.h"
+
+struct Turn {
+  Game *game;
+  std::deque<Action> actions;
+
+  ~Turn();
+};
+
+// All distinct positions reachable by the current player in one turn, along
+// with the actions leading to each. Caller owns the returned turns.
+std::vector<Turn*> get_turns(const Game *game);
+
+#endif